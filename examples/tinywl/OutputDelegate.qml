@@ -65,6 +65,8 @@ OutputItem {
         output: waylandOutput
         devicePixelRatio: parent.devicePixelRatio
         anchors.centerIn: parent
+        tearingPolicy: OutputViewport.TearingForFullscreen
+        vrrPolicy: OutputViewport.VrrForFullscreen
 
         RotationAnimation {
             id: rotationAnimator
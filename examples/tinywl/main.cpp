@@ -23,6 +23,11 @@
 #include <wxwaylandsurface.h>
 #include <woutputmanagerv1.h>
 #include <wcursorshapemanagerv1.h>
+#include <wtearingcontrolv1.h>
+#include <wlinuxdrmsyncobjv1.h>
+#include <wrelativepointerv1.h>
+#include <wpointerconstraintsv1.h>
+#include <wviewporter.h>
 #include <woutputitem.h>
 #include <woutputviewport.h>
 
@@ -79,6 +84,7 @@ Helper::Helper(QObject *parent)
     m_seat->setEventFilter(this);
     m_seat->setCursor(m_cursor);
     m_cursor->setLayout(m_outputLayout);
+    m_cursor->setCoalesceInput(true);
 }
 
 Helper::~Helper()
@@ -274,6 +280,12 @@ void Helper::initProtocols(WOutputRenderWindow *window, QQmlEngine *qmlEngine)
     });
 
     m_cursorShapeManager = m_server->attach<WCursorShapeManagerV1>();
+    m_server->attach<WTearingControlManagerV1>();
+    m_server->attach<WRelativePointerManagerV1>();
+    m_server->attach<WPointerConstraintsV1>();
+    m_server->attach<WViewporter>();
+    if (WLinuxDrmSyncobjManagerV1::isSupported(m_renderer, backend->handle()))
+        m_server->attach<WLinuxDrmSyncobjManagerV1>(m_renderer, m_compositor);
     m_fractionalScaleManagerV1 = qw_fractional_scale_manager_v1::create(*m_server->handle(), WLR_FRACTIONAL_SCALE_V1_VERSION);
     qw_data_control_manager_v1::create(*m_server->handle());
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "wcursor.h"
+#include "wseat.h"
 #include "private/wglobal_p.h"
 
 #include <qwcursor.h>
@@ -33,6 +34,7 @@ struct wlr_touch_down_event;
 struct wlr_touch_up_event;
 struct wlr_touch_motion_event;
 struct wlr_touch_cancel_event;
+struct wl_event_source;
 
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -72,6 +74,30 @@ public:
 
     void connect();
     void processCursorMotion(QW_NAMESPACE::qw_pointer *device, uint32_t time);
+    void notifyAxis(QW_NAMESPACE::qw_pointer *device, wlr_axis_source_t source,
+                    Qt::Orientation orientation, double delta, int32_t deltaDiscrete,
+                    uint32_t time);
+
+    // for input coalescing
+    struct PendingEvent {
+        enum Type {
+            Motion,
+            Axis,
+            Frame,
+        } type;
+        QW_NAMESPACE::qw_pointer *device = nullptr;
+        uint32_t time = 0;
+        // for axis
+        wlr_axis_source_t source = 0;
+        Qt::Orientation orientation = Qt::Vertical;
+        double delta = 0;
+        int32_t deltaDiscrete = 0;
+
+        bool canMerge(const PendingEvent &other) const;
+    };
+    void queueEvent(const PendingEvent &event);
+    void flushPendingEvents();
+    static void handleIdleFlush(void *data);
 
     W_DECLARE_PUBLIC(WCursor)
 
@@ -90,6 +116,10 @@ public:
     Qt::MouseButton button = Qt::NoButton;
     QPointF lastPressedOrTouchDownPosition;
     bool visible = true;
+
+    bool coalesceInput = false;
+    QList<PendingEvent> pendingEvents;
+    wl_event_source *idleFlushSource = nullptr;
 };
 
 WAYLIB_SERVER_END_NAMESPACE
@@ -28,6 +28,7 @@ public:
     void stop();
 
     void initSocket(WSocket *socketServer);
+    void processWaylandEvents(WServer::DispatchSource source);
 
     W_DECLARE_PUBLIC(WServer)
     std::unique_ptr<QSocketNotifier> sockNot;
@@ -37,6 +38,8 @@ public:
 
     std::unique_ptr<QW_NAMESPACE::qw_display> display;
     wl_event_loop *loop = nullptr;
+    bool dispatching = false;
+    quint64 dispatchCounts[WServer::DispatchSourceCount] = {};
 
     QList<WSocket*> sockets;
 
@@ -10,6 +10,10 @@
 #include <QObject>
 #include <QPointer>
 
+QT_BEGIN_NAMESPACE
+class QSocketNotifier;
+QT_END_NAMESPACE
+
 struct wlr_surface;
 struct wlr_subsurface;
 
@@ -26,6 +30,10 @@ public:
 
     WWRAP_HANDLE_FUNCTIONS(QW_NAMESPACE::qw_surface, wlr_surface)
 
+    inline static WSurfacePrivate *get(WSurface *qq) {
+        return qq->d_func();
+    }
+
     wl_client *waylandClient() const override;
 
     // begin slot function
@@ -40,9 +48,18 @@ public:
     void setPrimaryOutput(WOutput *output);
     void setBuffer(QW_NAMESPACE::qw_buffer *newBuffer);
     void updateBuffer();
+    void updateTextureUploadBytes();
     void updateBufferOffset();
     void updatePreferredBufferScale();
     void preferredBufferScaleChange();
+    void setTearingAllowed(bool newTearingAllowed);
+    void updateAcquireFence();
+    void waitAcquireFence();
+    inline bool acquireFenceIsPending() const {
+        return acquireFenceNotifier;
+    }
+    int takeAcquireFence();
+    bool hasAcquireTimeline() const;
 
     WSurface *ensureSubsurface(wlr_subsurface *subsurface);
     void setSubsurface(QW_NAMESPACE::qw_subsurface *newSubsurface);
@@ -54,6 +71,7 @@ public:
     QPointer<QW_NAMESPACE::qw_subsurface> subsurface;
     bool hasSubsurface = false;
     bool isSubsurface = false;  // qpointer would be null due to qwsubsurface' destroy, cache here
+    bool tearingAllowed = false;
     uint32_t preferredBufferScale = 1;
     uint32_t explicitPreferredBufferScale = 0;
 
@@ -62,6 +80,15 @@ public:
     WOutput *primaryOutput = nullptr;
     QMetaObject::Connection frameDoneConnection;
     QPoint bufferOffset;
+    // sync_file of the current buffer's acquire point of linux-drm-syncobj-v1
+    int acquireFence = -1;
+    QSocketNotifier *acquireFenceNotifier = nullptr;
+    // Set by the renderer if it can wait the acquire fences on the GPU, otherwise
+    // the new buffer is held back until its acquire point is signalled.
+    static bool gpuWaitsAcquireFence;
+
+    quint64 textureUploadBytes = 0;
+    static quint64 totalTextureUploadBytes;
 };
 
 WAYLIB_SERVER_END_NAMESPACE
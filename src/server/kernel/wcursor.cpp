@@ -8,6 +8,7 @@
 #include "wcursor.h"
 #include "private/wcursor_p.h"
 #include "winputdevice.h"
+#include "winputlatencytracker.h"
 #include "wimagebuffer.h"
 #include "wseat.h"
 #include "woutput.h"
@@ -23,6 +24,9 @@
 #include <qwpointer.h>
 #include <qwtouch.h>
 #include <qwseat.h>
+#include <qwdisplay.h>
+
+#include <wayland-server-core.h>
 
 #include <QPixmap>
 #include <QCoreApplication>
@@ -44,11 +48,18 @@ WCursorPrivate::WCursorPrivate(WCursor *qq)
 
 WCursorPrivate::~WCursorPrivate()
 {
-
+    if (idleFlushSource)
+        wl_event_source_remove(idleFlushSource);
 }
 
 void WCursorPrivate::instantRelease()
 {
+    pendingEvents.clear();
+    if (idleFlushSource) {
+        wl_event_source_remove(idleFlushSource);
+        idleFlushSource = nullptr;
+    }
+
     if (seat)
         seat->setCursor(nullptr);
 
@@ -109,19 +120,44 @@ void WCursorPrivate::sendLeaveEvent()
 void WCursorPrivate::on_motion(wlr_pointer_motion_event *event)
 {
     auto device = qw_pointer::from(event->pointer);
-    q_func()->move(device, QPointF(event->delta_x, event->delta_y));
+    QPointF delta(event->delta_x, event->delta_y);
+
+    // The relative motion is forwarded to the client before the cursor moves,
+    // a locked pointer ends here without hit-testing and rendering.
+    if (Q_LIKELY(seat) && !seat->notifyRelativeMotion(q_func(), WInputDevice::fromHandle(device), &delta,
+                                                      QPointF(event->unaccel_dx, event->unaccel_dy),
+                                                      event->time_msec)) {
+        return;
+    }
+
+    q_func()->move(device, delta);
     processCursorMotion(device, event->time_msec);
 }
 
 void WCursorPrivate::on_motion_absolute(wlr_pointer_motion_absolute_event *event)
 {
     auto device = qw_pointer::from(event->pointer);
-    q_func()->setScalePosition(device, QPointF(event->x, event->y));
+
+    // The pointer constraints work on the deltas, so an absolute device (e.g. a
+    // tablet or a virtual pointer of a remote desktop) moves by the delta to
+    // its new position, a locked pointer doesn't move and a confined pointer
+    // doesn't escape.
+    double x, y;
+    handle()->absolute_to_layout_coords(&event->pointer->base, event->x, event->y, &x, &y);
+    QPointF delta = QPointF(x, y) - q_func()->position();
+    if (Q_LIKELY(seat) && !seat->notifyRelativeMotion(q_func(), WInputDevice::fromHandle(device), &delta,
+                                                      delta, event->time_msec)) {
+        return;
+    }
+
+    q_func()->move(device, delta);
     processCursorMotion(device, event->time_msec);
 }
 
 void WCursorPrivate::on_button(wlr_pointer_button_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     button = WCursor::fromNativeButton(event->button);
 
@@ -141,17 +177,19 @@ void WCursorPrivate::on_button(wlr_pointer_button_event *event)
 void WCursorPrivate::on_axis(wlr_pointer_axis_event *event)
 {
     auto device = qw_pointer::from(event->pointer);
-
-    if (Q_LIKELY(seat)) {
-        seat->notifyAxis(q_func(), WInputDevice::fromHandle(device), event->source,
-                         event->orientation == WLR_AXIS_ORIENTATION_HORIZONTAL
-                         ? Qt::Horizontal : Qt::Vertical, event->delta, event->delta_discrete,
-                         event->time_msec);
-    }
+    notifyAxis(device, event->source,
+               event->orientation == WLR_AXIS_ORIENTATION_HORIZONTAL
+               ? Qt::Horizontal : Qt::Vertical, event->delta, event->delta_discrete,
+               event->time_msec);
 }
 
 void WCursorPrivate::on_frame()
 {
+    if (coalesceInput) {
+        queueEvent({PendingEvent::Frame});
+        return;
+    }
+
     if (Q_LIKELY(seat)) {
         seat->notifyFrame(q_func());
     }
@@ -159,6 +197,8 @@ void WCursorPrivate::on_frame()
 
 void WCursorPrivate::on_swipe_begin(wlr_pointer_swipe_begin_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyGestureBegin(q_func(), WInputDevice::fromHandle(device),
@@ -168,6 +208,8 @@ void WCursorPrivate::on_swipe_begin(wlr_pointer_swipe_begin_event *event)
 
 void WCursorPrivate::on_swipe_update(wlr_pointer_swipe_update_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         QPointF delta = QPointF(event->dx, event->dy);
@@ -178,6 +220,8 @@ void WCursorPrivate::on_swipe_update(wlr_pointer_swipe_update_event *event)
 
 void WCursorPrivate::on_swipe_end(wlr_pointer_swipe_end_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyGestureEnd(q_func(), WInputDevice::fromHandle(device),
@@ -187,6 +231,8 @@ void WCursorPrivate::on_swipe_end(wlr_pointer_swipe_end_event *event)
 
 void WCursorPrivate::on_pinch_begin(wlr_pointer_pinch_begin_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyGestureBegin(q_func(), WInputDevice::fromHandle(device),
@@ -196,6 +242,8 @@ void WCursorPrivate::on_pinch_begin(wlr_pointer_pinch_begin_event *event)
 
 void WCursorPrivate::on_pinch_update(wlr_pointer_pinch_update_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         QPointF delta = QPointF(event->dx, event->dy);
@@ -207,6 +255,8 @@ void WCursorPrivate::on_pinch_update(wlr_pointer_pinch_update_event *event)
 
 void WCursorPrivate::on_pinch_end(wlr_pointer_pinch_end_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyGestureEnd(q_func(), WInputDevice::fromHandle(device),
@@ -217,6 +267,8 @@ void WCursorPrivate::on_pinch_end(wlr_pointer_pinch_end_event *event)
 
 void WCursorPrivate::on_hold_begin(wlr_pointer_hold_begin_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyHoldBegin(q_func(), WInputDevice::fromHandle(device),
@@ -226,6 +278,8 @@ void WCursorPrivate::on_hold_begin(wlr_pointer_hold_begin_event *event)
 
 void WCursorPrivate::on_hold_end(wlr_pointer_hold_end_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_pointer::from(event->pointer);
     if (Q_LIKELY(seat)) {
         seat->notifyHoldEnd(q_func(), WInputDevice::fromHandle(device),
@@ -235,6 +289,8 @@ void WCursorPrivate::on_hold_end(wlr_pointer_hold_end_event *event)
 
 void WCursorPrivate::on_touch_down(wlr_touch_down_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_touch::from(event->touch);
 
     q_func()->setScalePosition(device, QPointF(event->x, event->y));
@@ -249,6 +305,8 @@ void WCursorPrivate::on_touch_down(wlr_touch_down_event *event)
 
 void WCursorPrivate::on_touch_motion(wlr_touch_motion_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_touch::from(event->touch);
 
     q_func()->setScalePosition(device, QPointF(event->x, event->y));
@@ -261,6 +319,8 @@ void WCursorPrivate::on_touch_motion(wlr_touch_motion_event *event)
 
 void WCursorPrivate::on_touch_frame()
 {
+    flushPendingEvents();
+
     if (Q_LIKELY(seat)) {
         seat->notifyTouchFrame(q_func());
     }
@@ -268,6 +328,8 @@ void WCursorPrivate::on_touch_frame()
 
 void WCursorPrivate::on_touch_cancel(wlr_touch_cancel_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_touch::from(event->touch);
 
     if (Q_LIKELY(seat)) {
@@ -278,6 +340,8 @@ void WCursorPrivate::on_touch_cancel(wlr_touch_cancel_event *event)
 
 void WCursorPrivate::on_touch_up(wlr_touch_up_event *event)
 {
+    flushPendingEvents();
+
     auto device = qw_touch::from(event->touch);
 
     if (Q_LIKELY(seat)) {
@@ -346,10 +410,136 @@ void WCursorPrivate::processCursorMotion(qw_pointer *device, uint32_t time)
 {
     W_Q(WCursor);
 
+    if (coalesceInput) {
+        PendingEvent event {PendingEvent::Motion};
+        event.device = device;
+        event.time = time;
+        queueEvent(event);
+        return;
+    }
+
     if (Q_LIKELY(seat))
         seat->notifyMotion(q, WInputDevice::fromHandle(device), time);
 }
 
+void WCursorPrivate::notifyAxis(qw_pointer *device, wlr_axis_source_t source,
+                                Qt::Orientation orientation, double delta,
+                                int32_t deltaDiscrete, uint32_t time)
+{
+    if (coalesceInput) {
+        PendingEvent event {PendingEvent::Axis};
+        event.device = device;
+        event.time = time;
+        event.source = source;
+        event.orientation = orientation;
+        event.delta = delta;
+        event.deltaDiscrete = deltaDiscrete;
+        queueEvent(event);
+        return;
+    }
+
+    if (Q_LIKELY(seat)) {
+        seat->notifyAxis(q_func(), WInputDevice::fromHandle(device), source,
+                         orientation, delta, deltaDiscrete, time);
+    }
+}
+
+bool WCursorPrivate::PendingEvent::canMerge(const PendingEvent &other) const
+{
+    if (type != other.type || device != other.device)
+        return false;
+
+    if (type == Axis)
+        return source == other.source && orientation == other.orientation;
+
+    return type == Motion;
+}
+
+void WCursorPrivate::queueEvent(const PendingEvent &event)
+{
+    if (!seat)
+        return;
+
+    if (event.type != PendingEvent::Frame) {
+        if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+            WInputLatencyTracker::instance()->markInput(WInputDevice::fromHandle(event.device));
+
+        // Merge into the previous event of the same kind, the frame that
+        // followed it still closes the merged event.
+        int index = pendingEvents.size() - 1;
+        if (index >= 0 && pendingEvents.at(index).type == PendingEvent::Frame)
+            --index;
+
+        if (index >= 0 && pendingEvents.at(index).canMerge(event)) {
+            auto &pending = pendingEvents[index];
+            pending.time = event.time;
+            pending.delta += event.delta;
+            pending.deltaDiscrete += event.deltaDiscrete;
+            return;
+        }
+    } else if (!pendingEvents.isEmpty() && pendingEvents.last().type == PendingEvent::Frame) {
+        return;
+    }
+
+    pendingEvents.append(event);
+
+    if (idleFlushSource)
+        return;
+
+    // Flush at the end of the current wayland event loop dispatch, all events
+    // read from the backend in one go are delivered to Qt as one batch, before
+    // returning to the Qt event loop and before any posted render request.
+    auto server = seat->server();
+    if (!server || !server->handle()) {
+        flushPendingEvents();
+        return;
+    }
+
+    auto loop = wl_display_get_event_loop(server->handle()->handle());
+    idleFlushSource = wl_event_loop_add_idle(loop, &WCursorPrivate::handleIdleFlush, this);
+    if (!idleFlushSource)
+        flushPendingEvents();
+}
+
+void WCursorPrivate::handleIdleFlush(void *data)
+{
+    auto d = reinterpret_cast<WCursorPrivate*>(data);
+    // The idle source is destroyed by wayland after this call
+    d->idleFlushSource = nullptr;
+    d->flushPendingEvents();
+}
+
+void WCursorPrivate::flushPendingEvents()
+{
+    if (pendingEvents.isEmpty())
+        return;
+
+    if (idleFlushSource) {
+        wl_event_source_remove(idleFlushSource);
+        idleFlushSource = nullptr;
+    }
+
+    W_Q(WCursor);
+    const auto events = std::exchange(pendingEvents, {});
+    if (!seat)
+        return;
+
+    for (const auto &event : events) {
+        switch (event.type) {
+        case PendingEvent::Motion:
+            seat->notifyMotion(q, WInputDevice::fromHandle(event.device), event.time);
+            break;
+        case PendingEvent::Axis:
+            seat->notifyAxis(q, WInputDevice::fromHandle(event.device), event.source,
+                             event.orientation, event.delta, event.deltaDiscrete, event.time);
+            break;
+        case PendingEvent::Frame:
+            seat->notifyFrame(q);
+            break;
+        }
+    }
+}
+
 WCursor::WCursor(WCursorPrivate &dd, QObject *parent)
     : WWrapObject(dd, parent)
 {
@@ -497,6 +687,8 @@ void WCursor::setSeat(WSeat *seat)
 {
     W_D(WCursor);
 
+    d->flushPendingEvents();
+
     if (d->seat) {
         // reconnect signals
         d->handle()->disconnect(this);
@@ -624,6 +816,9 @@ void WCursor::detachInputDevice(WInputDevice *device)
     if (!d->deviceList.removeOne(device))
         return;
 
+    // Deliver the events of this device while it's still valid
+    d->flushPendingEvents();
+
     d->handle()->detach_input_device(device->handle()->handle());
     d->handle()->map_input_to_output(device->handle()->handle(), nullptr);
 
@@ -702,6 +897,43 @@ QPointF WCursor::lastPressedOrTouchDownPosition() const
     return d->lastPressedOrTouchDownPosition;
 }
 
+/*!
+ * \brief Whether pointer motion and axis events are coalesced before delivery
+ *
+ * When enabled, the cursor position (and so the hardware cursor) still follows
+ * every backend event immediately, but consecutive motion and axis events are
+ * merged and delivered to Qt and the clients once per wayland event loop
+ * dispatch, with the timestamp of the newest event. A backlog of events that
+ * piled up while the compositor was busy rendering is then handled as one
+ * event instead of replaying every step through the scene.
+ * Button, gesture, touch and keyboard events flush the queue first, so the
+ * event order is kept.
+ */
+bool WCursor::coalesceInput() const
+{
+    W_DC(WCursor);
+    return d->coalesceInput;
+}
+
+void WCursor::setCoalesceInput(bool on)
+{
+    W_D(WCursor);
+    if (d->coalesceInput == on)
+        return;
+
+    d->coalesceInput = on;
+    if (!on)
+        d->flushPendingEvents();
+
+    Q_EMIT coalesceInputChanged();
+}
+
+void WCursor::flushPendingInput()
+{
+    W_D(WCursor);
+    d->flushPendingEvents();
+}
+
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "moc_wcursor.cpp"
@@ -36,6 +36,7 @@ class WAYLIB_SERVER_EXPORT WCursor : public WWrapObject
     Q_PROPERTY(QCursor cursor READ cursor WRITE setCursor NOTIFY cursorChanged FINAL)
     Q_PROPERTY(QPointF position READ position NOTIFY positionChanged FINAL)
     Q_PROPERTY(WAYLIB_SERVER_NAMESPACE::WSurface* requestedDragSurface READ requestedDragSurface NOTIFY requestedDragSurfaceChanged FINAL)
+    Q_PROPERTY(bool coalesceInput READ coalesceInput WRITE setCoalesceInput NOTIFY coalesceInputChanged FINAL)
     QML_ANONYMOUS
 
 public:
@@ -80,6 +81,9 @@ public:
     QPointF position() const;
     QPointF lastPressedOrTouchDownPosition() const;
 
+    bool coalesceInput() const;
+    void setCoalesceInput(bool on);
+
 Q_SIGNALS:
     void positionChanged();
     void seatChanged();
@@ -89,6 +93,7 @@ Q_SIGNALS:
     void layoutChanged();
     void cursorChanged();
     void visibleChanged();
+    void coalesceInputChanged();
 
 protected:
     WCursor(WCursorPrivate &dd, QObject *parent = nullptr);
@@ -105,6 +110,7 @@ private:
     void setSeat(WSeat *seat);
     bool attachInputDevice(WInputDevice *device);
     void detachInputDevice(WInputDevice *device);
+    void flushPendingInput();
 
     W_PRIVATE_SLOT(void on_swipe_begin(wlr_pointer_swipe_begin_event *event))
     W_PRIVATE_SLOT(void on_swipe_update(wlr_pointer_swipe_update_event *event))
@@ -0,0 +1,353 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "winputlatencytracker.h"
+#include "winputdevice.h"
+#include "woutput.h"
+#include "wtools.h"
+#include "private/wglobal_p.h"
+
+#include <QInputDevice>
+#include <QJSEngine>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QMetaEnum>
+#include <QTextStream>
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+Q_LOGGING_CATEGORY(qLcInputLatency, "waylib.server.input.latency", QtInfoMsg)
+
+static inline QString deviceName(WInputDevice *device)
+{
+    return device->qtDevice() ? device->qtDevice()->name() : QString();
+}
+
+bool WInputLatencyTracker::active = false;
+
+class Q_DECL_HIDDEN WInputLatencyTrackerPrivate : public WObjectPrivate
+{
+public:
+    WInputLatencyTrackerPrivate(WInputLatencyTracker *qq)
+        : WObjectPrivate(qq)
+    {}
+
+    W_DECLARE_PUBLIC(WInputLatencyTracker)
+
+    struct Sample {
+        WInputDevice *device = nullptr;
+        // -1 means the stage was not reached, e.g. no surface took the event
+        qint64 nsecs[WInputLatencyTracker::StageCount];
+
+        Sample() {
+            std::fill(std::begin(nsecs), std::end(nsecs), -1);
+        }
+    };
+
+    struct PendingPresent {
+        QPointer<WOutput> output;
+        QList<Sample> samples;
+    };
+
+    struct DeviceStats {
+        WInputLatencyTracker::Histogram histograms[WInputLatencyTracker::StageCount];
+    };
+
+    void ensureDevice(WInputDevice *device);
+    void removeDevice(WInputDevice *device);
+    void record(const Sample &sample);
+
+    bool enabled = false;
+    // At most one sample per device waits for a frame, later events from the
+    // same device are covered by it, so the oldest unrendered event is measured.
+    QHash<WInputDevice*, Sample> pending;
+    QList<Sample> inFlight;
+    QList<PendingPresent> pendingPresents;
+    QHash<WInputDevice*, DeviceStats> stats;
+};
+
+void WInputLatencyTrackerPrivate::ensureDevice(WInputDevice *device)
+{
+    if (stats.contains(device))
+        return;
+
+    stats.insert(device, {});
+    QObject::connect(device, &QObject::destroyed, q_func(), [this, device] {
+        removeDevice(device);
+    });
+}
+
+void WInputLatencyTrackerPrivate::removeDevice(WInputDevice *device)
+{
+    stats.remove(device);
+    pending.remove(device);
+
+    auto isDevice = [device] (const Sample &s) {
+        return s.device == device;
+    };
+    inFlight.removeIf(isDevice);
+    for (auto &p : pendingPresents)
+        p.samples.removeIf(isDevice);
+}
+
+void WInputLatencyTrackerPrivate::record(const Sample &sample)
+{
+    auto it = stats.find(sample.device);
+    if (it == stats.end())
+        return;
+
+    const qint64 arrival = sample.nsecs[WInputLatencyTracker::Arrival];
+    for (int stage = WInputLatencyTracker::Arrival + 1; stage < WInputLatencyTracker::StageCount; ++stage) {
+        if (sample.nsecs[stage] < 0)
+            continue;
+
+        const qint64 nsecs = sample.nsecs[stage] - arrival;
+        auto &h = it->histograms[stage];
+        h.minNsecs = h.samples > 0 ? qMin(h.minNsecs, nsecs) : nsecs;
+        h.maxNsecs = qMax(h.maxNsecs, nsecs);
+        h.totalNsecs += nsecs;
+        ++h.samples;
+
+        int bucket = 0;
+        while (bucket < WInputLatencyTracker::BucketCount - 1
+               && nsecs >= WInputLatencyTracker::BucketBoundsUsecs[bucket] * 1000) {
+            ++bucket;
+        }
+        ++h.buckets[bucket];
+    }
+}
+
+/*!
+ * \brief The WInputLatencyTracker class measures input-to-photon latency
+ *
+ * When enabled, the first unrendered input event of every device is stamped
+ * with a monotonic timestamp at each \l Stage, from the wlroots event up to the
+ * presentation feedback of the output that displayed the next frame. The
+ * latencies are collected into per-device histograms.
+ *
+ * The tracker can also be enabled by the \c WAYLIB_TRACK_INPUT_LATENCY
+ * environment variable.
+ */
+WInputLatencyTracker::WInputLatencyTracker(QObject *parent)
+    : QObject(parent)
+    , WObject(*new WInputLatencyTrackerPrivate(this))
+{
+    if (qEnvironmentVariableIsSet("WAYLIB_TRACK_INPUT_LATENCY"))
+        setEnabled(true);
+}
+
+WInputLatencyTracker::~WInputLatencyTracker()
+{
+    active = false;
+}
+
+WInputLatencyTracker *WInputLatencyTracker::instance()
+{
+    static WInputLatencyTracker *tracker = new WInputLatencyTracker(qApp);
+    return tracker;
+}
+
+WInputLatencyTracker *WInputLatencyTracker::create(QQmlEngine *, QJSEngine *)
+{
+    auto tracker = instance();
+    QJSEngine::setObjectOwnership(tracker, QJSEngine::CppOwnership);
+    return tracker;
+}
+
+bool WInputLatencyTracker::isEnabled() const
+{
+    W_DC(WInputLatencyTracker);
+    return d->enabled;
+}
+
+void WInputLatencyTracker::setEnabled(bool on)
+{
+    W_D(WInputLatencyTracker);
+    if (d->enabled == on)
+        return;
+
+    d->enabled = on;
+    active = on;
+
+    if (!on) {
+        d->pending.clear();
+        d->inFlight.clear();
+        d->pendingPresents.clear();
+    }
+
+    Q_EMIT enabledChanged();
+}
+
+QList<WInputDevice*> WInputLatencyTracker::devices() const
+{
+    W_DC(WInputLatencyTracker);
+    return d->stats.keys();
+}
+
+WInputLatencyTracker::Histogram WInputLatencyTracker::histogram(WInputDevice *device, Stage stage) const
+{
+    W_DC(WInputLatencyTracker);
+    if (stage < 0 || stage >= StageCount)
+        return {};
+    return d->stats.value(device).histograms[stage];
+}
+
+QVariantList WInputLatencyTracker::histograms() const
+{
+    W_DC(WInputLatencyTracker);
+    const QMetaEnum stageEnum = QMetaEnum::fromType<Stage>();
+
+    QVariantList list;
+    for (auto it = d->stats.cbegin(); it != d->stats.cend(); ++it) {
+        for (int stage = Arrival + 1; stage < StageCount; ++stage) {
+            const auto &h = it->histograms[stage];
+            if (h.samples == 0)
+                continue;
+
+            QVariantList buckets;
+            for (int i = 0; i < BucketCount; ++i)
+                buckets.append(h.buckets[i]);
+
+            list.append(QVariantMap {
+                {QStringLiteral("device"), QVariant::fromValue(it.key())},
+                {QStringLiteral("deviceName"), deviceName(it.key())},
+                {QStringLiteral("stage"), QString::fromLatin1(stageEnum.valueToKey(stage))},
+                {QStringLiteral("samples"), h.samples},
+                {QStringLiteral("averageMsecs"), h.averageMsecs()},
+                {QStringLiteral("minMsecs"), h.minNsecs / 1000000.0},
+                {QStringLiteral("maxMsecs"), h.maxNsecs / 1000000.0},
+                {QStringLiteral("buckets"), buckets},
+            });
+        }
+    }
+
+    return list;
+}
+
+QString WInputLatencyTracker::report() const
+{
+    W_DC(WInputLatencyTracker);
+    const QMetaEnum stageEnum = QMetaEnum::fromType<Stage>();
+
+    QString text;
+    QTextStream stream(&text);
+    stream << "Input latency buckets (us):";
+    for (int i = 0; i < BucketCount - 1; ++i)
+        stream << " <" << BucketBoundsUsecs[i];
+    stream << " >=" << BucketBoundsUsecs[BucketCount - 2] << "\n";
+
+    for (auto it = d->stats.cbegin(); it != d->stats.cend(); ++it) {
+        stream << deviceName(it.key()) << ":\n";
+        for (int stage = Arrival + 1; stage < StageCount; ++stage) {
+            const auto &h = it->histograms[stage];
+            stream << "  " << stageEnum.valueToKey(stage) << ": samples=" << h.samples;
+            if (h.samples > 0) {
+                stream << " avg=" << h.averageMsecs() << "ms"
+                       << " min=" << h.minNsecs / 1000000.0 << "ms"
+                       << " max=" << h.maxNsecs / 1000000.0 << "ms"
+                       << " [";
+                for (int i = 0; i < BucketCount; ++i)
+                    stream << (i ? " " : "") << h.buckets[i];
+                stream << "]";
+            }
+            stream << "\n";
+        }
+    }
+
+    return text;
+}
+
+void WInputLatencyTracker::dump() const
+{
+    const auto lines = report().split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    for (const auto &line : lines)
+        qCInfo(qLcInputLatency).noquote() << line;
+}
+
+void WInputLatencyTracker::reset()
+{
+    W_D(WInputLatencyTracker);
+    for (auto &s : d->stats)
+        s = {};
+    d->pending.clear();
+    d->inFlight.clear();
+    d->pendingPresents.clear();
+}
+
+void WInputLatencyTracker::markInput(WInputDevice *device)
+{
+    W_D(WInputLatencyTracker);
+    if (!d->enabled || !device || d->pending.contains(device))
+        return;
+
+    d->ensureDevice(device);
+    WInputLatencyTrackerPrivate::Sample sample;
+    sample.device = device;
+    sample.nsecs[Arrival] = WTools::monotonicNsecs();
+    d->pending.insert(device, sample);
+}
+
+void WInputLatencyTracker::markDelivery(WInputDevice *device, Stage stage)
+{
+    Q_ASSERT(stage == QtDelivery || stage == ClientDelivery);
+    W_D(WInputLatencyTracker);
+    auto it = d->pending.find(device);
+    if (it == d->pending.end() || it->nsecs[stage] >= 0)
+        return;
+
+    it->nsecs[stage] = WTools::monotonicNsecs();
+}
+
+void WInputLatencyTracker::markFrameStarted()
+{
+    W_D(WInputLatencyTracker);
+    const qint64 now = WTools::monotonicNsecs();
+
+    // Samples of a frame that didn't commit anything are measured against the
+    // frame that finally displays them.
+    for (auto &sample : d->inFlight)
+        sample.nsecs[RenderStart] = now;
+
+    for (auto &sample : d->pending) {
+        sample.nsecs[RenderStart] = now;
+        d->inFlight.append(sample);
+    }
+    d->pending.clear();
+}
+
+bool WInputLatencyTracker::markCommitted(WOutput *output)
+{
+    W_D(WInputLatencyTracker);
+    if (d->inFlight.isEmpty())
+        return false;
+
+    // The first output that commits after the input displays it, the other
+    // outputs of the same frame don't take the samples again.
+    const qint64 now = WTools::monotonicNsecs();
+    for (auto &sample : d->inFlight)
+        sample.nsecs[Commit] = now;
+
+    d->pendingPresents.append({output, std::exchange(d->inFlight, {})});
+    return true;
+}
+
+void WInputLatencyTracker::markPresented(WOutput *output, bool presented, qint64 presentNsecs)
+{
+    W_D(WInputLatencyTracker);
+    for (int i = 0; i < d->pendingPresents.size(); ++i) {
+        if (d->pendingPresents.at(i).output != output)
+            continue;
+
+        auto samples = d->pendingPresents.takeAt(i).samples;
+        if (presentNsecs <= 0)
+            presentNsecs = WTools::monotonicNsecs();
+        for (auto &sample : samples) {
+            if (presented)
+                sample.nsecs[Present] = presentNsecs;
+            d->record(sample);
+        }
+        break;
+    }
+}
+
+WAYLIB_SERVER_END_NAMESPACE
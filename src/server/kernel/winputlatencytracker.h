@@ -0,0 +1,98 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+
+#include <QObject>
+#include <QQmlEngine>
+
+QT_BEGIN_NAMESPACE
+class QJSEngine;
+QT_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WInputDevice;
+class WOutput;
+class WInputLatencyTrackerPrivate;
+class WAYLIB_SERVER_EXPORT WInputLatencyTracker : public QObject, public WObject
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WInputLatencyTracker)
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged FINAL)
+    QML_NAMED_ELEMENT(InputLatencyTracker)
+    QML_SINGLETON
+
+public:
+    // Every stage is measured from the Arrival of the input event.
+    enum Stage {
+        Arrival,        // wlroots emitted the input event
+        QtDelivery,     // Qt delivered the event to the seat's event filter
+        ClientDelivery, // WSeat::sendEvent forwarded the event to a surface
+        RenderStart,    // the next frame that consumed the event started to render
+        Commit,         // that frame was committed to an output
+        Present,        // the output reported the frame as presented
+        StageCount
+    };
+    Q_ENUM(Stage)
+
+    // Bucket upper bounds in microseconds, the last bucket is unbounded.
+    static constexpr int BucketCount = 12;
+    static constexpr qint64 BucketBoundsUsecs[BucketCount - 1] = {
+        250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000, 256000
+    };
+
+    struct Histogram {
+        quint64 samples = 0;
+        qint64 totalNsecs = 0;
+        qint64 minNsecs = 0;
+        qint64 maxNsecs = 0;
+        quint64 buckets[BucketCount] = {};
+
+        inline qreal averageMsecs() const {
+            return samples > 0 ? totalNsecs / 1000000.0 / samples : 0;
+        }
+    };
+
+    static WInputLatencyTracker *instance();
+    static WInputLatencyTracker *create(QQmlEngine *, QJSEngine *);
+
+    // Cheap check for the hooks in the input and render paths
+    static inline bool isActive() {
+        return active;
+    }
+
+    bool isEnabled() const;
+    void setEnabled(bool on);
+
+    QList<WInputDevice*> devices() const;
+    Histogram histogram(WInputDevice *device, Stage stage) const;
+
+    Q_INVOKABLE QVariantList histograms() const;
+    Q_INVOKABLE QString report() const;
+    Q_INVOKABLE void dump() const;
+    Q_INVOKABLE void reset();
+
+    // Called by the seat, render loop and outputs, only if isActive()
+    void markInput(WInputDevice *device);
+    void markDelivery(WInputDevice *device, Stage stage);
+    void markFrameStarted();
+    // Returns true if the commit took samples, the output must then report
+    // the matching present event (or its loss) by markPresented, presentNsecs
+    // is the CLOCK_MONOTONIC time of the present event.
+    bool markCommitted(WOutput *output);
+    void markPresented(WOutput *output, bool presented, qint64 presentNsecs = 0);
+
+Q_SIGNALS:
+    void enabledChanged();
+
+private:
+    explicit WInputLatencyTracker(QObject *parent = nullptr);
+    ~WInputLatencyTracker();
+
+    static bool active;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -4,6 +4,7 @@
 #include "woutput.h"
 #include "wbackend.h"
 #include "wcursor.h"
+#include "winputlatencytracker.h"
 #include "wseat.h"
 #include "wtools.h"
 #include "platformplugin/qwlrootscreen.h"
@@ -56,16 +57,86 @@ public:
         return static_cast<WOutput::Transform>(nativeHandle()->transform);
     }
 
+    void onBufferCommitted(bool tearing);
+    void setPowerOn(bool on);
+    void onPresent(wlr_output_event_present *event);
+
     W_DECLARE_PUBLIC(WOutput)
 
     bool forceSoftwareCursor = false;
+    bool powerOn = true;
     QWlrootsScreen *screen = nullptr;
     QQuickWindow *window = nullptr;
 
     WBackend *backend = nullptr;
     WOutputLayout *layout = nullptr;
+
+    struct PendingPresent {
+        qint64 commitNsecs;
+        bool tearing;
+        bool hasInputSamples;
+    };
+    QList<PendingPresent> pendingPresents;
+    WOutput::PresentLatency latency[2];
+    // From the last present event, for WOutput::predictedPresentNsecs
+    qint64 lastPresentNsecs = 0;
+    qint64 presentRefreshNsecs = 0;
 };
 
+void WOutputPrivate::onBufferCommitted(bool tearing)
+{
+    // The present events are in the same order as the commits, avoid
+    // to grow up if the backend doesn't send present event.
+    if (pendingPresents.size() > 8) {
+        if (pendingPresents.takeFirst().hasInputSamples)
+            WInputLatencyTracker::instance()->markPresented(q_func(), false);
+    }
+
+    const bool hasInputSamples = WInputLatencyTracker::isActive()
+                                 && WInputLatencyTracker::instance()->markCommitted(q_func());
+    pendingPresents.append({WTools::monotonicNsecs(), tearing, hasInputSamples});
+}
+
+void WOutputPrivate::setPowerOn(bool on)
+{
+    if (powerOn == on)
+        return;
+    powerOn = on;
+    Q_EMIT q_func()->powerOnChanged();
+}
+
+void WOutputPrivate::onPresent(wlr_output_event_present *event)
+{
+    // The time the frame is shown, instead of the time this event is handled
+    qint64 presentNsecs = 0;
+    if (event->presented) {
+#if WLR_VERSION_MINOR >= 19
+        const timespec &when = event->when;
+#else
+        const timespec &when = *event->when;
+#endif
+        presentNsecs = when.tv_sec * 1000000000ll + when.tv_nsec;
+        lastPresentNsecs = presentNsecs;
+        presentRefreshNsecs = event->refresh;
+    }
+
+    if (pendingPresents.isEmpty())
+        return;
+
+    const auto pending = pendingPresents.takeFirst();
+    if (pending.hasInputSamples)
+        WInputLatencyTracker::instance()->markPresented(q_func(), event->presented, presentNsecs);
+    if (!event->presented)
+        return;
+
+    const qint64 nsecs = (presentNsecs > 0 ? presentNsecs : WTools::monotonicNsecs()) - pending.commitNsecs;
+    auto &l = latency[pending.tearing ? 1 : 0];
+    l.minNsecs = l.frames > 0 ? qMin(l.minNsecs, nsecs) : nsecs;
+    l.maxNsecs = qMax(l.maxNsecs, nsecs);
+    l.totalNsecs += nsecs;
+    ++l.frames;
+}
+
 WOutput::WOutput(qw_output *handle, WBackend *backend)
     : WWrapObject(*new WOutputPrivate(this, handle))
 {
@@ -89,11 +160,23 @@ WOutput::WOutput(qw_output *handle, WBackend *backend)
             Q_EMIT this->effectiveSizeChanged();
         }
 
-        if (event->state->committed & WLR_OUTPUT_STATE_BUFFER)
+        if (event->state->committed & WLR_OUTPUT_STATE_BUFFER) {
+            d_func()->onBufferCommitted(event->state->tearing_page_flip);
             Q_EMIT this->bufferCommitted();
+        }
 
-        if (event->state->committed & WLR_OUTPUT_STATE_ENABLED)
+        if (event->state->committed & WLR_OUTPUT_STATE_ENABLED) {
+            // Enabled by the others (output management, modeset), it's not powered off anymore
+            if (event->state->enabled)
+                d_func()->setPowerOn(true);
             Q_EMIT this->enabledChanged();
+        }
+
+        if (event->state->committed & WLR_OUTPUT_STATE_ADAPTIVE_SYNC_ENABLED)
+            Q_EMIT this->adaptiveSyncEnabledChanged();
+    });
+    connect(handle, &qw_output::notify_present, this, [this] (wlr_output_event_present *event) {
+        d_func()->onPresent(event);
     });
 }
 
@@ -478,6 +561,41 @@ bool WOutput::isEnabled() const
     return d->nativeHandle()->enabled;
 }
 
+bool WOutput::isPowerOn() const
+{
+    W_DC(WOutput);
+    return d->powerOn;
+}
+
+// Powering off (DPMS) disables the output but keeps its mode and its place
+// in the layout, the renderer stops rendering for it and releases its buffers.
+void WOutput::setPowerOn(bool on)
+{
+    W_D(WOutput);
+    if (d->powerOn == on)
+        return;
+
+    wlr_output_state state;
+    wlr_output_state_init(&state);
+    wlr_output_state_set_enabled(&state, on);
+    const bool ok = d->handle()->commit_state(&state);
+    wlr_output_state_finish(&state);
+
+    if (!ok) {
+        qCWarning(qLcOutput) << "Failed to power" << (on ? "on" : "off") << "the output" << name();
+        return;
+    }
+
+    // Powering on is synced by the commit event
+    d->setPowerOn(on);
+}
+
+bool WOutput::adaptiveSyncEnabled() const
+{
+    W_DC(WOutput);
+    return d->nativeHandle()->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
+}
+
 QPoint WOutput::position() const
 {
     W_DC(WOutput);
@@ -688,4 +806,45 @@ void WOutput::setForceSoftwareCursor(bool on)
     Q_EMIT forceSoftwareCursorChanged();
 }
 
+WOutput::PresentLatency WOutput::presentLatency(bool tearing) const
+{
+    W_DC(WOutput);
+    return d->latency[tearing ? 1 : 0];
+}
+
+qreal WOutput::averagePresentLatency(bool tearing) const
+{
+    return presentLatency(tearing).averageMsecs();
+}
+
+void WOutput::resetPresentLatency()
+{
+    W_D(WOutput);
+    d->latency[0] = {};
+    d->latency[1] = {};
+}
+
+qint64 WOutput::refreshNsecs() const
+{
+    W_DC(WOutput);
+    if (d->presentRefreshNsecs > 0)
+        return d->presentRefreshNsecs;
+    // The refresh of the mode is in mHz
+    const int refresh = d->nativeHandle()->refresh;
+    return refresh > 0 ? 1000000000000ll / refresh : 0;
+}
+
+qint64 WOutput::predictedPresentNsecs() const
+{
+    W_DC(WOutput);
+    const qint64 now = WTools::monotonicNsecs();
+    const qint64 refresh = refreshNsecs();
+    if (refresh <= 0)
+        return now;
+    if (d->lastPresentNsecs <= 0 || d->lastPresentNsecs > now)
+        return now + refresh;
+
+    return d->lastPresentNsecs + ((now - d->lastPresentNsecs) / refresh + 1) * refresh;
+}
+
 WAYLIB_SERVER_END_NAMESPACE
@@ -41,9 +41,11 @@ class WAYLIB_SERVER_EXPORT WOutput : public WWrapObject
     Q_OBJECT
     W_DECLARE_PRIVATE(WOutput)
     Q_PROPERTY(bool enabled READ isEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool powerOn READ isPowerOn WRITE setPowerOn NOTIFY powerOnChanged FINAL)
     Q_PROPERTY(QSize size READ effectiveSize NOTIFY effectiveSizeChanged)
     Q_PROPERTY(Transform orientation READ orientation NOTIFY orientationChanged)
     Q_PROPERTY(float scale READ scale NOTIFY scaleChanged)
+    Q_PROPERTY(bool adaptiveSyncEnabled READ adaptiveSyncEnabled NOTIFY adaptiveSyncEnabledChanged)
     Q_PROPERTY(bool forceSoftwareCursor READ forceSoftwareCursor WRITE setForceSoftwareCursor NOTIFY forceSoftwareCursorChanged)
     Q_PROPERTY(QString name READ name CONSTANT)
     QML_NAMED_ELEMENT(WaylandOutput)
@@ -62,6 +64,19 @@ public:
     };
     Q_ENUM(Transform)
 
+    // The time from commit a buffer to the buffer is presented,
+    // vsync and tearing(async page flip) commits are counted separately.
+    struct PresentLatency {
+        quint64 frames = 0;
+        qint64 totalNsecs = 0;
+        qint64 minNsecs = 0;
+        qint64 maxNsecs = 0;
+
+        inline qreal averageMsecs() const {
+            return frames > 0 ? totalNsecs / 1000000.0 / frames : 0;
+        }
+    };
+
     explicit WOutput(QW_NAMESPACE::qw_output *handle, WBackend *backend);
     ~WOutput();
 
@@ -85,6 +100,9 @@ public:
 
     QString name() const;
     bool isEnabled() const;
+    bool isPowerOn() const;
+    void setPowerOn(bool on);
+    bool adaptiveSyncEnabled() const;
     QPoint position() const;
     QSize size() const;
     QSize transformedSize() const;
@@ -115,8 +133,21 @@ public:
     bool forceSoftwareCursor() const;
     void setForceSoftwareCursor(bool on);
 
+    PresentLatency presentLatency(bool tearing) const;
+    Q_INVOKABLE qreal averagePresentLatency(bool tearing) const;
+    Q_INVOKABLE void resetPresentLatency();
+
+    // The refresh period reported by the last present event, or of the
+    // current mode, 0 if unknown.
+    qint64 refreshNsecs() const;
+    // The CLOCK_MONOTONIC time the next vblank is expected at, extrapolated
+    // from the last presented frame.
+    qint64 predictedPresentNsecs() const;
+
 Q_SIGNALS:
     void enabledChanged();
+    void powerOnChanged();
+    void adaptiveSyncEnabledChanged();
     void positionChanged(const QPoint &pos);
     void modeChanged();
     void transformedSizeChanged();
@@ -4,9 +4,12 @@
 #include "wseat.h"
 #include "wcursor.h"
 #include "winputdevice.h"
+#include "winputlatencytracker.h"
 #include "woutput.h"
 #include "wsurface.h"
 #include "wxdgsurface.h"
+#include "wrelativepointerv1.h"
+#include "wpointerconstraintsv1.h"
 #include "platformplugin/qwlrootsintegration.h"
 #include "private/wglobal_p.h"
 
@@ -19,15 +22,23 @@
 #include <qwcompositor.h>
 #include <qwdisplay.h>
 #include <qwprimaryselection.h>
+#include <qwpointerconstraintsv1.h>
+
+extern "C" {
+#include <wlr/util/region.h>
+}
 
 #include <QQuickWindow>
 #include <QGuiApplication>
 #include <QQuickItem>
 #include <QDebug>
 #include <QTimer>
+#include <QBitArray>
 
 #include <qpa/qwindowsysteminterface.h>
 #include <private/qxkbcommon_p.h>
+#include <private/qguiapplication_p.h>
+#include <private/qshortcutmap_p.h>
 #include <private/qquickwindow_p.h>
 #include <private/qquickdeliveryagent_p_p.h>
 
@@ -173,6 +184,7 @@ public:
             return false;
         }
         Q_ASSERT(pointerFocusSurface() == surface->handle()->handle());
+        updatePointerConstraint();
 
         Q_ASSERT(!pointerFocusEventObject || eventObject != pointerFocusEventObject);
         if (pointerFocusEventObject) {
@@ -191,6 +203,7 @@ public:
     }
     inline void doClearPointerFocus() {
         pointerFocusEventObject.clear();
+        setPointerConstraint(nullptr);
         handle()->pointer_notify_clear_focus();
         Q_ASSERT(!handle()->handle()->pointer_state.focused_surface);
         if (cursor) // reset cursur from QCursor resource, the last cursor is from wlr_surface
@@ -272,6 +285,8 @@ public:
         q_func()->setKeyboard(device);
         /* Send modifiers to the client. */
         this->handle()->keyboard_notify_key(timestamp, keycode, state);
+        if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+            WInputLatencyTracker::instance()->markDelivery(device, WInputLatencyTracker::ClientDelivery);
         return true;
     }
     inline bool doNotifyModifiers(WInputDevice *device) {
@@ -317,6 +332,9 @@ public:
     void detachInputDevice(WInputDevice *device);
     // handle spontaneous & synthetic key event for focusWindow
     void handleKeyEvent(QKeyEvent &e);
+    // for pointer constraints
+    void updatePointerConstraint();
+    void setPointerConstraint(wlr_pointer_constraint_v1 *constraint);
 
     W_DECLARE_PUBLIC(WSeat)
 
@@ -389,6 +407,21 @@ public:
     };
 
     // for keyboard event
+    struct KeyboardState {
+        // Keycodes whose every level produces printable text. Without a
+        // Ctrl/Alt/Meta modifier, such a key is forwarded to the client without
+        // building a QKeyEvent unless a shortcut takes it, e.g. "Space" or "Shift+A".
+        QBitArray textKeys;
+    };
+    static void compileTextKeys(KeyboardState *state, xkb_keymap *keymap);
+    static bool mayMatchShortcut(int qtkey, Qt::KeyboardModifiers modifiers);
+    inline bool isPlainTextKey(WInputDevice *device, qw_keyboard *keyboard, xkb_keycode_t code) const {
+        if (keyboard->get_modifiers() & (WLR_MODIFIER_CTRL | WLR_MODIFIER_ALT | WLR_MODIFIER_LOGO))
+            return false;
+        auto *state = device->getAttachedData<KeyboardState>();
+        return state && code < uint(state->textKeys.size()) && state->textKeys.testBit(code);
+    }
+
     QTimer m_repeatTimer;
     std::unique_ptr<QKeyEvent> m_repeatKey;
 
@@ -401,8 +434,44 @@ public:
     WGlobal::CursorShape cursorShape = WGlobal::CursorShape::Invalid;
 
     QPointer<WSurface> dragSurface;
+
+    // for relative pointer and pointer constraints
+    QPointer<WRelativePointerManagerV1> relativePointerManager;
+    // The active constraint of the pointer focus surface
+    wlr_pointer_constraint_v1 *pointerConstraint = nullptr;
+    // The surface local position of the confined pointer, the pointer_state is
+    // stale until the coalesced motion events are delivered by WCursor.
+    QPointF confinedPosition;
+    bool confinedPositionIsValid = false;
 };
 
+void WSeatPrivate::updatePointerConstraint()
+{
+    wlr_pointer_constraint_v1 *constraint = nullptr;
+    auto server = q_func()->server();
+    auto surface = pointerFocusSurface() ? WSurface::fromHandle(pointerFocusSurface()) : nullptr;
+
+    if (surface && server) {
+        if (auto constraints = server->findInterface<WPointerConstraintsV1>())
+            constraint = constraints->constraintForSurface(q_func(), surface);
+    }
+
+    setPointerConstraint(constraint);
+}
+
+void WSeatPrivate::setPointerConstraint(wlr_pointer_constraint_v1 *constraint)
+{
+    if (pointerConstraint == constraint)
+        return;
+
+    confinedPositionIsValid = false;
+    // A oneshot constraint is destroyed by the deactivation
+    if (auto oldConstraint = std::exchange(pointerConstraint, constraint))
+        wlr_pointer_constraint_v1_send_deactivated(oldConstraint);
+    if (constraint)
+        wlr_pointer_constraint_v1_send_activated(constraint);
+}
+
 void WSeatPrivate::on_destroy()
 {
     q_func()->m_handle = nullptr;
@@ -497,12 +566,36 @@ void WSeatPrivate::handleKeyEvent(QKeyEvent &e)
 }
 void WSeatPrivate::on_keyboard_key(wlr_keyboard_key_event *event, WInputDevice *device)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
+    // Keep the order with the coalesced pointer events
+    if (cursor)
+        cursor->flushPendingInput();
+
     auto keyboard = qobject_cast<qw_keyboard*>(device->handle());
 
     auto code = event->keycode + 8; // map to wl_keyboard::keymap_format::keymap_format_xkb_v1
     auto et = event->state == WL_KEYBOARD_KEY_STATE_PRESSED ? QEvent::KeyPress : QEvent::KeyRelease;
+
+    // Fast path: without a focus window the event only has to be checked
+    // against shortcuts, which never happens for releases, so skip the
+    // keysym translation and QKeyEvent entirely.
+    if (!focusWindow && et == QEvent::KeyRelease) {
+        doNotifyKey(device, event->keycode, event->state, event->time_msec);
+        return;
+    }
+
     xkb_keysym_t sym = xkb_state_key_get_one_sym(keyboard->handle()->xkb_state, code);
     int qtkey = QXkbCommon::keysymToQtKey(sym, keyModifiers, keyboard->handle()->xkb_state, code);
+
+    // A plain text key that no shortcut takes skips the text lookup and QKeyEvent
+    if (!focusWindow && isPlainTextKey(device, keyboard, code)
+        && !mayMatchShortcut(qtkey, keyModifiers)) {
+        doNotifyKey(device, event->keycode, event->state, event->time_msec);
+        return;
+    }
+
     const QString &text = QXkbCommon::lookupString(keyboard->handle()->xkb_state, code);
 
     QKeyEvent e(et, qtkey, keyModifiers, code, event->keycode, keyboard->get_modifiers(),
@@ -534,6 +627,57 @@ void WSeatPrivate::on_keyboard_key(wlr_keyboard_key_event *event, WInputDevice *
     }
 }
 
+bool WSeatPrivate::mayMatchShortcut(int qtkey, Qt::KeyboardModifiers modifiers)
+{
+    auto &shortcutMap = QGuiApplicationPrivate::instance()->shortcutMap;
+    // The key may complete a multi-key sequence
+    if (shortcutMap.state() != QKeySequence::NoMatch)
+        return true;
+
+    // The Shift of a text key may be a part of the key or the shortcut
+    const auto key = Qt::Key(qtkey);
+    return shortcutMap.hasShortcutForKeySequence(QKeySequence(QKeyCombination(modifiers, key)))
+           || shortcutMap.hasShortcutForKeySequence(QKeySequence(QKeyCombination(modifiers & ~Qt::ShiftModifier, key)));
+}
+
+void WSeatPrivate::compileTextKeys(KeyboardState *state, xkb_keymap *keymap)
+{
+    state->textKeys.clear();
+    if (!keymap)
+        return;
+
+    const xkb_keycode_t minCode = xkb_keymap_min_keycode(keymap);
+    const xkb_keycode_t maxCode = xkb_keymap_max_keycode(keymap);
+    state->textKeys.resize(maxCode + 1);
+
+    for (xkb_keycode_t code = minCode; code <= maxCode; ++code) {
+        bool hasSym = false;
+        bool isText = true;
+        const xkb_layout_index_t layouts = xkb_keymap_num_layouts_for_key(keymap, code);
+
+        for (xkb_layout_index_t layout = 0; isText && layout < layouts; ++layout) {
+            const xkb_level_index_t levels = xkb_keymap_num_levels_for_key(keymap, code, layout);
+            for (xkb_level_index_t level = 0; isText && level < levels; ++level) {
+                const xkb_keysym_t *syms = nullptr;
+                const int count = xkb_keymap_key_get_syms_by_level(keymap, code, layout, level, &syms);
+                for (int i = 0; i < count; ++i) {
+                    const uint32_t ucs = xkb_keysym_to_utf32(syms[i]);
+                    hasSym = true;
+                    // Control characters (Tab, Return, Escape, BackSpace...) and
+                    // keysyms without text (F1, arrows, XF86 keys...) stay on the
+                    // full path, they are common shortcut keys.
+                    if (ucs < 0x20 || (ucs >= 0x7f && ucs < 0xa0)) {
+                        isText = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        state->textKeys.setBit(code, hasSym && isText);
+    }
+}
+
 void WSeatPrivate::on_keyboard_modifiers(WInputDevice *device)
 {
     auto keyboard = qobject_cast<qw_keyboard*>(device->handle());
@@ -598,10 +742,20 @@ void WSeatPrivate::attachInputDevice(WInputDevice *device)
         struct xkb_keymap *keymap = xkb_map_new_from_names(context, &rules,
                                                            XKB_KEYMAP_COMPILE_NO_FLAGS);
 
+        auto *keyboardState = new WSeatPrivate::KeyboardState;
+        device->setAttachedData<WSeatPrivate::KeyboardState>(keyboardState);
+
         keyboard->set_keymap(keymap);
         xkb_keymap_unref(keymap);
         xkb_context_unref(context);
         keyboard->set_repeat_info(25, 600);
+        compileTextKeys(keyboardState, keyboard->handle()->keymap);
+
+        device->safeConnect(&qw_keyboard::notify_keymap, q, [device] () {
+            auto keyboard = qobject_cast<qw_keyboard*>(device->handle());
+            if (auto *state = device->getAttachedData<WSeatPrivate::KeyboardState>())
+                compileTextKeys(state, keyboard->handle()->keymap);
+        });
 
         device->safeConnect(&qw_keyboard::notify_key, q, [this, device] (wlr_keyboard_key_event *event) {
             on_keyboard_key(event, device);
@@ -618,6 +772,12 @@ void WSeatPrivate::detachInputDevice(WInputDevice *device)
     if (cursor && device->type() == WInputDevice::Type::Pointer)
         cursor->detachInputDevice(device);
 
+    if (device->type() == WInputDevice::Type::Keyboard) {
+        auto *state = device->getAttachedData<WSeatPrivate::KeyboardState>();
+        device->removeAttachedData<WSeatPrivate::KeyboardState>();
+        delete state;
+    }
+
     if (device->type() == WInputDevice::Type::Touch) {
         qCDebug(qLcWlrTouch, "WSeat: detachTouchDevice %s", qPrintable(device->qtDevice()->name()));
         auto *state = device->getAttachedData<WSeatPrivate::DeviceState>();
@@ -794,6 +954,9 @@ bool WSeat::sendEvent(WSurface *target, QObject *shellObject, QObject *eventObje
     auto seat = inputDevice->seat();
     auto d = seat->d_func();
 
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markDelivery(inputDevice, WInputLatencyTracker::ClientDelivery);
+
     auto eventState = d->getEventState(event);
     if (eventState)
         eventState->isAccepted = true;
@@ -1036,15 +1199,23 @@ void WSeat::setKeyboard(WInputDevice *newKeyboard)
 
 void WSeat::notifyMotion(WCursor *cursor, WInputDevice *device, uint32_t timestamp)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
     W_D(WSeat);
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
     d->doMouseMove(cursor, qwDevice, timestamp);
+    // The pointer_state is synced by the delivery
+    d->confinedPositionIsValid = false;
 }
 
 void WSeat::notifyButton(WCursor *cursor, WInputDevice *device, Qt::MouseButton button,
                          wlr_button_state_t state, uint32_t timestamp)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
     W_D(WSeat);
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
@@ -1071,6 +1242,9 @@ void WSeat::notifyAxis(WCursor *cursor, WInputDevice *device, wlr_axis_source_t
                        Qt::Orientation orientation,
                        double delta, int32_t delta_discrete, uint32_t timestamp)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
     W_D(WSeat);
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
@@ -1099,6 +1273,54 @@ void WSeat::notifyFrame(WCursor *cursor)
     d->doNotifyFrame();
 }
 
+bool WSeat::notifyRelativeMotion(WCursor *cursor, WInputDevice *device, QPointF *delta,
+                                 const QPointF &unaccelDelta, uint32_t timestamp)
+{
+    Q_UNUSED(cursor);
+    Q_UNUSED(device);
+    W_D(WSeat);
+
+    auto surface = d->pointerFocusSurface();
+    if (!surface)
+        return true;
+
+    // Straight from the wlroots event, the client gets the raw deltas
+    // without waiting for the QtQuick event delivery.
+    if (d->relativePointerManager) {
+        d->relativePointerManager->sendRelativeMotion(this, uint64_t(timestamp) * 1000,
+                                                      *delta, unaccelDelta);
+    }
+
+    auto constraint = d->pointerConstraint;
+    if (!constraint || constraint->surface != surface)
+        return true;
+
+    // The locked pointer doesn't move, so the cursor and the scene
+    // don't change, and no QtQuick hit-testing is needed.
+    if (constraint->type == WLR_POINTER_CONSTRAINT_V1_LOCKED)
+        return false;
+
+    // Confined, the surface local coordinates are assumed in the same
+    // scale as the cursor's, it's true if the surface isn't transformed.
+    if (!d->confinedPositionIsValid) {
+        const auto &state = d->nativeHandle()->pointer_state;
+        d->confinedPosition = QPointF(state.sx, state.sy);
+        d->confinedPositionIsValid = true;
+    }
+
+    const QPointF from = d->confinedPosition;
+    double x, y;
+    if (wlr_region_confine(&constraint->region, from.x(), from.y(),
+                           from.x() + delta->x(), from.y() + delta->y(), &x, &y)) {
+        *delta = QPointF(x - from.x(), y - from.y());
+    } else {
+        *delta = QPointF();
+    }
+    d->confinedPosition += *delta;
+
+    return true;
+}
+
 void WSeat::notifyGestureBegin(WCursor *cursor, WInputDevice *device, uint32_t time_msec, uint32_t fingers, WGestureEvent::WLibInputGestureType libInputGestureType)
 {
     W_D(WSeat);
@@ -1213,6 +1435,9 @@ void WSeat::notifyHoldEnd(WCursor *cursor, WInputDevice *device, uint32_t time_m
 
 void WSeat::notifyTouchDown(WCursor *cursor, WInputDevice *device, int32_t touch_id, uint32_t time_msec)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
     W_D(WSeat);
     auto qwDevice = qobject_cast<QPointingDevice*>(device->qtDevice());
     Q_ASSERT(qwDevice);
@@ -1251,6 +1476,8 @@ void WSeat::notifyTouchDown(WCursor *cursor, WInputDevice *device, int32_t touch
 
 void WSeat::notifyTouchMotion(WCursor *cursor, WInputDevice *device, int32_t touch_id, uint32_t time_msec)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
 
     W_DC(WSeat);
     auto qwDevice = qobject_cast<QPointingDevice*>(device->qtDevice());
@@ -1281,6 +1508,9 @@ void WSeat::notifyTouchMotion(WCursor *cursor, WInputDevice *device, int32_t tou
 
 void WSeat::notifyTouchUp(WCursor *cursor, WInputDevice *device, int32_t touch_id, uint32_t time_msec)
 {
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markInput(device);
+
     W_DC(WSeat);
     auto qwDevice = qobject_cast<QPointingDevice*>(device->qtDevice());
     Q_ASSERT(qwDevice);
@@ -1349,6 +1579,28 @@ void WSeat::setCursorShape(wlr_seat_client *client, WGlobal::CursorShape shape)
     Q_EMIT requestCursorShape(shape);
 }
 
+void WSeat::setRelativePointerManager(WRelativePointerManagerV1 *manager)
+{
+    W_D(WSeat);
+    d->relativePointerManager = manager;
+}
+
+void WSeat::updatePointerConstraint()
+{
+    W_D(WSeat);
+    d->updatePointerConstraint();
+}
+
+void WSeat::removePointerConstraint(wlr_pointer_constraint_v1 *constraint)
+{
+    W_D(WSeat);
+    // Don't send the deactivated event to the destroying constraint
+    if (d->pointerConstraint == constraint) {
+        d->pointerConstraint = nullptr;
+        d->confinedPositionIsValid = false;
+    }
+}
+
 WSeatEventFilter *WSeat::eventFilter() const
 {
     W_DC(WSeat);
@@ -1382,6 +1634,7 @@ void WSeat::create(WServer *server)
         d->gesture = qw_pointer_gestures_v1::create(*server->handle());
 
     d->updateCapabilities();
+    d->relativePointerManager = server->findInterface<WRelativePointerManagerV1>();
 
     if (d->cursor)
         // after d->attachInputDevice
@@ -1429,6 +1682,11 @@ bool WSeat::filterEventBeforeDisposeStage(QWindow *targetWindow, QInputEvent *ev
 
     d->addEventState(event);
 
+    if (Q_UNLIKELY(WInputLatencyTracker::isActive())) {
+        if (auto device = WInputDevice::from(event->device()))
+            WInputLatencyTracker::instance()->markDelivery(device, WInputLatencyTracker::QtDelivery);
+    }
+
     if (Q_UNLIKELY(d->eventFilter)) {
         if (d->eventFilter->beforeDisposeEvent(this, targetWindow, event)) {
             if (event->type() == QEvent::MouseMove || event->type() == QEvent::HoverMove) {
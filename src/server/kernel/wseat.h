@@ -27,6 +27,7 @@ typedef uint wlr_axis_source_t;
 typedef uint wlr_button_state_t;
 struct wlr_seat;
 struct wlr_seat_client;
+struct wlr_pointer_constraint_v1;
 
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -50,6 +51,7 @@ protected:
 };
 
 class WCursor;
+class WRelativePointerManagerV1;
 class WSeatPrivate;
 class WAYLIB_SERVER_EXPORT WSeat : public WWrapObject, public WServerInterface
 {
@@ -114,6 +116,8 @@ protected:
     friend class QWlrootsRenderWindow;
     friend class WEventJunkman;
     friend class WCursorShapeManagerV1;
+    friend class WRelativePointerManagerV1;
+    friend class WPointerConstraintsV1;
 
     void create(WServer *server) override;
     void destroy(WServer *server) override;
@@ -134,6 +138,9 @@ protected:
                     Qt::Orientation orientation,
                     double delta, int32_t delta_discrete, uint32_t timestamp);
     void notifyFrame(WCursor *cursor);
+    // Before the cursor moves, returns false if the pointer is locked
+    bool notifyRelativeMotion(WCursor *cursor, WInputDevice *device, QPointF *delta,
+                              const QPointF &unaccelDelta, uint32_t timestamp);
 
     // gesture
     void notifyGestureBegin(WCursor *cursor, WInputDevice *device, uint32_t time_msec, uint32_t fingers, WGestureEvent::WLibInputGestureType libInputGestureType);
@@ -150,6 +157,11 @@ protected:
     void notifyTouchFrame(WCursor *cursor);
 
     void setCursorShape(wlr_seat_client *client, WGlobal::CursorShape shape);
+
+    // relative pointer and pointer constraints
+    void setRelativePointerManager(WRelativePointerManagerV1 *manager);
+    void updatePointerConstraint();
+    void removePointerConstraint(wlr_pointer_constraint_v1 *constraint);
 };
 
 WAYLIB_SERVER_END_NAMESPACE
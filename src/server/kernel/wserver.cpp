@@ -24,6 +24,7 @@
 #include <QCoreApplication>
 #include <QAbstractEventDispatcher>
 #include <QSocketNotifier>
+#include <QScopedValueRollback>
 #include <QMutex>
 #include <QDebug>
 #include <QProcess>
@@ -107,18 +108,15 @@ void WServerPrivate::init()
     loop = wl_display_get_event_loop(display->handle());
     int fd = wl_event_loop_get_fd(loop);
 
-    auto processWaylandEvents = [this] {
-        int ret = wl_event_loop_dispatch(loop, 0);
-        if (ret)
-            fprintf(stderr, "wl_event_loop_dispatch error: %d\n", ret);
-        wl_display_flush_clients(display->handle());
-    };
-
     sockNot.reset(new QSocketNotifier(fd, QSocketNotifier::Read));
-    QObject::connect(sockNot.get(), &QSocketNotifier::activated, q, processWaylandEvents);
+    QObject::connect(sockNot.get(), &QSocketNotifier::activated, q, [this] {
+        processWaylandEvents(WServer::SocketNotifier);
+    });
 
     QAbstractEventDispatcher *dispatcher = QThread::currentThread()->eventDispatcher();
-    QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, q, processWaylandEvents);
+    QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, q, [this] {
+        processWaylandEvents(WServer::AboutToBlock);
+    });
 
     for (auto socket : std::as_const(sockets))
         initSocket(socket);
@@ -126,6 +124,20 @@ void WServerPrivate::init()
     Q_EMIT q->started();
 }
 
+void WServerPrivate::processWaylandEvents(WServer::DispatchSource source)
+{
+    // Not reentrant, e.g. a request handler triggers a render that dispatches
+    if (!loop || dispatching)
+        return;
+
+    ++dispatchCounts[source];
+    QScopedValueRollback<bool> guard(dispatching, true);
+    int ret = wl_event_loop_dispatch(loop, 0);
+    if (ret)
+        fprintf(stderr, "wl_event_loop_dispatch error: %d\n", ret);
+    wl_display_flush_clients(display->handle());
+}
+
 void WServerPrivate::stop()
 {
     W_Q(WServer);
@@ -143,6 +155,7 @@ void WServerPrivate::stop()
 
     sockNot.reset();
     QThread::currentThread()->eventDispatcher()->disconnect(q);
+    loop = nullptr;
     display.reset(nullptr);
 }
 
@@ -359,6 +372,34 @@ bool WServer::isRunning() const
     return d->display.get();
 }
 
+/*!
+ * Dispatches the pending wayland events (client requests and backend events)
+ * and flushes the events queued for the clients. This normally happens when the
+ * Qt event loop is about to block, calling it allows to handle the clients before
+ * a long task such as rendering a frame.
+ */
+void WServer::dispatchEvents()
+{
+    W_D(WServer);
+    d->processWaylandEvents(ExplicitDispatch);
+}
+
+/*!
+ * The times the wayland event loop was dispatched by  source, for the
+ * wakeup diagnostics, see WOutputRenderWindow::wakeupReport.
+ */
+quint64 WServer::dispatchCount(DispatchSource source) const
+{
+    W_DC(WServer);
+    return d->dispatchCounts[source];
+}
+
+void WServer::resetDispatchStats()
+{
+    W_D(WServer);
+    std::fill(std::begin(d->dispatchCounts), std::end(d->dispatchCounts), 0);
+}
+
 void WServer::addSocket(WSocket *socket)
 {
     W_D(WServer);
@@ -85,6 +85,15 @@ class WAYLIB_SERVER_EXPORT WServer : public QObject, public WObject
     friend class WShellInterface;
 
 public:
+    // What dispatched the wayland event loop, see dispatchCount
+    enum DispatchSource {
+        SocketNotifier,     // the event loop's fd is readable
+        AboutToBlock,       // the Qt event loop is about to block
+        ExplicitDispatch,   // dispatchEvents(), e.g. by the render loop
+        DispatchSourceCount
+    };
+    Q_ENUM(DispatchSource)
+
     explicit WServer(QObject *parent = nullptr);
 
     QW_NAMESPACE::qw_display *handle() const;
@@ -140,6 +149,9 @@ public:
     void initializeProxyQPA(int &argc, char **argv, const QStringList &proxyPlatformPlugins = {}, const QStringList &parameters = {});
 
     bool isRunning() const;
+    void dispatchEvents();
+    quint64 dispatchCount(DispatchSource source) const;
+    void resetDispatchStats();
     void addSocket(WSocket *socket);
 
     void setGlobalFilter(GlobalFilterFunc filter, void *data);
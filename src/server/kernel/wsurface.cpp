@@ -6,6 +6,7 @@
 #include "wseat.h"
 #include "private/wsurface_p.h"
 #include "woutput.h"
+#include "wtools.h"
 
 #include <qwoutput.h>
 #include <qwcompositor.h>
@@ -14,11 +15,20 @@
 #include <qwbuffer.h>
 #include <qwfractionalscalemanagerv1.h>
 #include <QDebug>
+#include <QSocketNotifier>
 
 extern "C" {
 #include <wlr/util/edges.h>
+#if WLR_VERSION_MINOR >= 18
+#include <wlr/render/drm_syncobj.h>
+#include <wlr/types/wlr_linux_drm_syncobj_v1.h>
+#endif
 }
 
+#include <unistd.h>
+#include <poll.h>
+#include <drm_fourcc.h>
+
 QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -30,7 +40,9 @@ WSurfacePrivate::WSurfacePrivate(WSurface *qq, qw_surface *handle)
 
 WSurfacePrivate::~WSurfacePrivate()
 {
-
+    delete acquireFenceNotifier;
+    if (acquireFence >= 0)
+        close(acquireFence);
 }
 
 wl_client *WSurfacePrivate::waylandClient() const
@@ -44,8 +56,14 @@ void WSurfacePrivate::on_commit()
 {
     W_Q(WSurface);
 
-    if (nativeHandle()->current.committed & WLR_SURFACE_STATE_BUFFER)
-        updateBuffer();
+    if (nativeHandle()->current.committed & WLR_SURFACE_STATE_BUFFER) {
+        updateTextureUploadBytes();
+        updateAcquireFence();
+        if (acquireFence >= 0 && !gpuWaitsAcquireFence)
+            waitAcquireFence();
+        else
+            updateBuffer();
+    }
 
     if (nativeHandle()->current.committed & WLR_SURFACE_STATE_OFFSET)
         updateBufferOffset();
@@ -154,6 +172,125 @@ void WSurfacePrivate::updateBuffer()
     setBuffer(buffer);
 }
 
+quint64 WSurfacePrivate::totalTextureUploadBytes = 0;
+bool WSurfacePrivate::gpuWaitsAcquireFence = false;
+
+// Estimate the bytes wlroots uploaded to the surface texture in this commit,
+// must be called before updateBuffer().
+void WSurfacePrivate::updateTextureUploadBytes()
+{
+    wlr_client_buffer *clientBuffer = nativeHandle()->buffer;
+    if (!clientBuffer || !clientBuffer->texture)
+        return;
+
+    // The texture doesn't keep the format, take it from the client's shm buffer,
+    // the unknown formats are counted as 4 bytes per pixel.
+    uint32_t format = DRM_FORMAT_INVALID;
+    for (wlr_buffer *source : {nativeHandle()->current.buffer, clientBuffer->source}) {
+        wlr_shm_attributes attribs;
+        if (source && wlr_buffer_get_shm(source, &attribs)) {
+            format = attribs.format;
+            break;
+        }
+    }
+    const qreal bytesPerPixel = WTools::drmFormatBytesPerPixel(format);
+    quint64 bytes = 0;
+
+    if (buffer && buffer->handle() == &clientBuffer->base) {
+        // The texture was updated in place by wlr_client_buffer_apply_damage,
+        // only the damage region of the buffer was uploaded.
+        int count = 0;
+        auto rects = pixman_region32_rectangles(&nativeHandle()->buffer_damage, &count);
+        for (int i = 0; i < count; ++i)
+            bytes += quint64(rects[i].x2 - rects[i].x1) * (rects[i].y2 - rects[i].y1);
+        bytes = quint64(bytes * bytesPerPixel);
+    } else if (clientBuffer->source) {
+        // A new texture, dmabuf buffers are imported without uploading.
+        wlr_dmabuf_attributes attribs;
+        if (wlr_buffer_get_dmabuf(clientBuffer->source, &attribs))
+            return;
+        bytes = quint64(qreal(clientBuffer->base.width) * clientBuffer->base.height * bytesPerPixel);
+    }
+
+    textureUploadBytes += bytes;
+    totalTextureUploadBytes += bytes;
+}
+
+void WSurfacePrivate::updateAcquireFence()
+{
+    // The waiting buffer is replaced by the new commit
+    if (acquireFenceNotifier) {
+        delete acquireFenceNotifier;
+        acquireFenceNotifier = nullptr;
+    }
+
+    if (acquireFence >= 0) {
+        close(acquireFence);
+        acquireFence = -1;
+    }
+
+#if WLR_VERSION_MINOR >= 18
+    auto state = wlr_linux_drm_syncobj_v1_get_surface_state(nativeHandle());
+    if (!state || !state->acquire_timeline || !nativeHandle()->buffer)
+        return;
+
+    // The commit is delayed by wlroots until the acquire point is materialized,
+    // so the sync_file is always valid here.
+    acquireFence = wlr_drm_syncobj_timeline_export_sync_file(state->acquire_timeline,
+                                                             state->acquire_point);
+#endif
+}
+
+// Wait the acquire point in the event loop instead of blocking the renderer,
+// the current buffer is given to the renderer after the client's rendering finished.
+void WSurfacePrivate::waitAcquireFence()
+{
+    Q_ASSERT(acquireFence >= 0);
+    Q_ASSERT(!acquireFenceNotifier);
+
+    auto onSignalled = [this] {
+        close(acquireFence);
+        acquireFence = -1;
+        updateBuffer();
+    };
+
+    pollfd pfd { acquireFence, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) > 0) {
+        onSignalled();
+        return;
+    }
+
+    W_Q(WSurface);
+    acquireFenceNotifier = new QSocketNotifier(acquireFence, QSocketNotifier::Read, q);
+    QObject::connect(acquireFenceNotifier, &QSocketNotifier::activated, q, [this, onSignalled] {
+        acquireFenceNotifier->setEnabled(false);
+        acquireFenceNotifier->deleteLater();
+        acquireFenceNotifier = nullptr;
+        onSignalled();
+    });
+}
+
+// The current buffer is synchronized by linux-drm-syncobj-v1, it's independent
+// of whether the acquire fence was already taken by the renderer.
+bool WSurfacePrivate::hasAcquireTimeline() const
+{
+#if WLR_VERSION_MINOR >= 18
+    auto state = wlr_linux_drm_syncobj_v1_get_surface_state(nativeHandle());
+    return state && state->acquire_timeline;
+#else
+    return false;
+#endif
+}
+
+// Only for the renderer that waits on the GPU, the fence watched by
+// waitAcquireFence is owned by the notifier until it's signalled.
+int WSurfacePrivate::takeAcquireFence()
+{
+    if (acquireFenceNotifier)
+        return -1;
+    return std::exchange(acquireFence, -1);
+}
+
 void WSurfacePrivate::updateBufferOffset()
 {
     W_Q(WSurface);
@@ -187,6 +324,15 @@ void WSurfacePrivate::preferredBufferScaleChange()
     Q_EMIT q->preferredBufferScaleChanged();
 }
 
+void WSurfacePrivate::setTearingAllowed(bool newTearingAllowed)
+{
+    if (tearingAllowed == newTearingAllowed)
+        return;
+    tearingAllowed = newTearingAllowed;
+
+    Q_EMIT q_func()->tearingAllowedChanged();
+}
+
 WSurface *WSurfacePrivate::ensureSubsurface(wlr_subsurface *subsurface)
 {
     if (auto surface = WSurface::fromHandle(subsurface->surface))
@@ -301,6 +447,14 @@ QPoint WSurface::bufferOffset() const
     return d->bufferOffset;
 }
 
+QRectF WSurface::bufferSourceBox() const
+{
+    W_DC(WSurface);
+    wlr_fbox box;
+    wlr_surface_get_buffer_source_box(d->nativeHandle(), &box);
+    return QRectF(box.x, box.y, box.width, box.height);
+}
+
 qw_buffer *WSurface::buffer() const
 {
     W_DC(WSurface);
@@ -449,6 +603,23 @@ void WSurface::resetPreferredBufferScale()
     setPreferredBufferScale(0);
 }
 
+bool WSurface::tearingAllowed() const
+{
+    W_DC(WSurface);
+    return d->tearingAllowed;
+}
+
+quint64 WSurface::textureUploadBytes() const
+{
+    W_DC(WSurface);
+    return d->textureUploadBytes;
+}
+
+quint64 WSurface::totalTextureUploadBytes()
+{
+    return WSurfacePrivate::totalTextureUploadBytes;
+}
+
 void WSurface::map()
 {
     W_D(WSurface);
@@ -33,6 +33,7 @@ class WAYLIB_SERVER_EXPORT WSurface : public WWrapObject
     Q_PROPERTY(QList<WSurface*> subsurfaces READ subsurfaces NOTIFY newSubsurface)
     Q_PROPERTY(WOutput* primaryOutput READ primaryOutput NOTIFY primaryOutputChanged)
     Q_PROPERTY(uint32_t preferredBufferScale READ preferredBufferScale WRITE setPreferredBufferScale RESET resetPreferredBufferScale NOTIFY preferredBufferScaleChanged FINAL)
+    Q_PROPERTY(bool tearingAllowed READ tearingAllowed NOTIFY tearingAllowedChanged FINAL)
     QML_NAMED_ELEMENT(WaylandSurface)
     QML_UNCREATABLE("Only create in C++")
 
@@ -51,6 +52,9 @@ public:
     WLR::Transform orientation() const;
     int bufferScale() const;
     QPoint bufferOffset() const;
+    // The region of the buffer mapped to size(), in buffer pixels, it
+    // includes the source crop of wp_viewporter.
+    QRectF bufferSourceBox() const;
     QW_NAMESPACE::qw_buffer *buffer() const;
 
     void notifyFrameDone();
@@ -64,6 +68,14 @@ public:
     void setPreferredBufferScale(uint32_t newPreferredBufferScale);
     void resetPreferredBufferScale();
 
+    // The presentation hint of wp_tearing_control_v1, requires WTearingControlManagerV1
+    bool tearingAllowed() const;
+
+    // Estimated bytes uploaded to the GPU for the buffers of this surface,
+    // and of all surfaces, dmabuf buffers are imported without uploading.
+    quint64 textureUploadBytes() const;
+    static quint64 totalTextureUploadBytes();
+
 public Q_SLOTS:
     void enterOutput(WOutput *output);
     void leaveOutput(WOutput *output);
@@ -82,6 +94,7 @@ Q_SIGNALS:
     void hasSubsurfaceChanged();
     void newSubsurface(WSurface *subsurface);
     void preferredBufferScaleChanged();
+    void tearingAllowedChanged();
     void outputEntered(WOutput *output);
     void outputLeft(WOutput *output);
 
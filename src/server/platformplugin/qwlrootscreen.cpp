@@ -172,9 +172,10 @@ QPlatformScreen::PowerState QWlrootsScreen::powerState() const
     return handle()->enabled ? PowerStateOn : PowerStateOff;
 }
 
-void QWlrootsScreen::setPowerState(PowerState)
+void QWlrootsScreen::setPowerState(PowerState state)
 {
-
+    // Standby and suspend are treated as off, wlroots has no other modes
+    m_output->setPowerOn(state == PowerStateOn);
 }
 
 QVector<QPlatformScreen::Mode> QWlrootsScreen::modes() const
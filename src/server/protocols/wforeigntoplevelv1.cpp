@@ -11,6 +11,10 @@
 #include <qwxdgshell.h>
 #include <qwdisplay.h>
 
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+
 #include <map>
 
 QW_USE_NAMESPACE
@@ -19,8 +23,30 @@ Q_LOGGING_CATEGORY(qLcWlrForeignToplevel, "waylib.protocols.foreigntoplevel", Qt
 
 class Q_DECL_HIDDEN WForeignToplevelPrivate : public WObjectPrivate {
 public:
+    enum Change {
+        TitleChange = 0x1,
+        AppIdChange = 0x2,
+        MinimizedChange = 0x4,
+        MaximizedChange = 0x8,
+        FullscreenChange = 0x10,
+        ActivatedChange = 0x20,
+        ParentChange = 0x40,
+        // Rate limited by textUpdateInterval
+        TextChanges = TitleChange | AppIdChange,
+    };
+
+    struct HandleState {
+        WSurface *surface = nullptr;
+        uint changes = 0;
+        QByteArray title;
+        QByteArray appId;
+        qint64 lastTextUpdate = -1;
+    };
+
     WForeignToplevelPrivate(WForeignToplevel *qq)
-        : WObjectPrivate(qq) {}
+        : WObjectPrivate(qq) {
+        clock.start();
+    }
     ~WForeignToplevelPrivate() {
         for (const auto &pair : std::as_const(connections)) {
             for (const auto &co : std::as_const(pair.second)) {
@@ -30,53 +56,42 @@ public:
 
         connections.clear();
         surfaces.clear();
+        states.clear();
+        surfaceIndex.clear();
     }
 
     void initSurface(WToplevelSurface *surface) {
         auto handle = surfaces[surface].get();
         std::vector<QMetaObject::Connection> connection;
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::titleChanged, surface, [handle, surface] {
-            handle->set_title(surface->title().toUtf8());
+        // The changes are coalesced and flushed once per event loop iteration
+        connection.push_back(surface->safeConnect(&WToplevelSurface::titleChanged, surface, [this, surface] {
+            markChanged(surface, TitleChange);
         }));
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::appIdChanged, surface, [handle, surface] {
-            handle->set_app_id(surface->appId().toLocal8Bit());
+        connection.push_back(surface->safeConnect(&WToplevelSurface::appIdChanged, surface, [this, surface] {
+            markChanged(surface, AppIdChange);
         }));
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::minimizeChanged, surface, [handle, surface] {
-            handle->set_minimized(surface->isMinimized());
+        connection.push_back(surface->safeConnect(&WToplevelSurface::minimizeChanged, surface, [this, surface] {
+            markChanged(surface, MinimizedChange);
         }));
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::maximizeChanged, surface, [handle, surface] {
-            handle->set_maximized(surface->isMaximized());
+        connection.push_back(surface->safeConnect(&WToplevelSurface::maximizeChanged, surface, [this, surface] {
+            markChanged(surface, MaximizedChange);
         }));
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::fullscreenChanged, surface, [handle, surface] {
-            handle->set_fullscreen(surface->isFullScreen());
+        connection.push_back(surface->safeConnect(&WToplevelSurface::fullscreenChanged, surface, [this, surface] {
+            markChanged(surface, FullscreenChange);
         }));
 
-        connection.push_back(surface->safeConnect(&WToplevelSurface::activateChanged, surface, [handle, surface] {
-            handle->set_activated(surface->isActivated());
+        connection.push_back(surface->safeConnect(&WToplevelSurface::activateChanged, surface, [this, surface] {
+            markChanged(surface, ActivatedChange);
         }));
 
-        auto updateSurfaceParent = [this, surface, handle] {
-            if (surface->parentSurface()) {
-                auto find = std::find_if(surfaces.begin(), surfaces.end(), [surface](const auto &pair) {
-                    return pair.first->surface() == surface->parentSurface();
-                });
-                if (find == surfaces.end()) {
-                    qCCritical(qLcWlrForeignToplevel) << "Toplevel surface " << surface
-                        << "has set parent surface, but foreign_toplevel_handle for parent surface not found!";
-                    return;
-                }
-
-                handle->set_parent(*find->second.get());
-            }
-            else
-                handle->set_parent(nullptr);
-        };
-        connection.push_back(surface->safeConnect(&WToplevelSurface::parentSurfaceChanged, surface, updateSurfaceParent));
+        connection.push_back(surface->safeConnect(&WToplevelSurface::parentSurfaceChanged, surface, [this, surface] {
+            markChanged(surface, ParentChange);
+        }));
 
         connection.push_back(surface->surface()->safeConnect(&WSurface::outputEntered, surface, [this, handle](WOutput *output) {
             handle->output_enter(output->nativeHandle());
@@ -122,17 +137,126 @@ public:
                             }));
 
 
-        handle->set_title(surface->title().toUtf8());
-        handle->set_app_id(surface->appId().toLocal8Bit());
+        auto &state = states[surface];
+        state.surface = surface->surface();
+        surfaceIndex.insert(state.surface, surface);
+
+        // Send the initial state at once
+        updateTitle(surface, handle, state);
+        updateAppId(surface, handle, state);
         handle->set_minimized(surface->isMinimized());
         handle->set_maximized(surface->isMaximized());
         handle->set_fullscreen(surface->isFullScreen());
         handle->set_activated(surface->isActivated());
-        updateSurfaceParent();
+        updateSurfaceParent(surface, handle);
 
         connections.insert({surface, connection});
     }
 
+    void updateTitle(WToplevelSurface *surface, qw_foreign_toplevel_handle_v1 *handle, HandleState &state) {
+        const auto title = surface->title().toUtf8();
+        if (state.title == title)
+            return;
+        state.title = title;
+        handle->set_title(title);
+    }
+
+    void updateAppId(WToplevelSurface *surface, qw_foreign_toplevel_handle_v1 *handle, HandleState &state) {
+        const auto appId = surface->appId().toLocal8Bit();
+        if (state.appId == appId)
+            return;
+        state.appId = appId;
+        handle->set_app_id(appId);
+    }
+
+    void updateSurfaceParent(WToplevelSurface *surface, qw_foreign_toplevel_handle_v1 *handle) {
+        auto parentSurface = surface->parentSurface();
+        if (!parentSurface) {
+            handle->set_parent(nullptr);
+            return;
+        }
+
+        auto parent = surfaceIndex.value(parentSurface);
+        if (!parent) {
+            qCCritical(qLcWlrForeignToplevel) << "Toplevel surface " << surface
+                << "has set parent surface, but foreign_toplevel_handle for parent surface not found!";
+            return;
+        }
+
+        handle->set_parent(*surfaces[parent].get());
+    }
+
+    void markChanged(WToplevelSurface *surface, Change change) {
+        auto &state = states[surface];
+        if (!state.changes)
+            dirtySurfaces.append(surface);
+        state.changes |= change;
+
+        if (flushScheduled)
+            return;
+        flushScheduled = true;
+        QMetaObject::invokeMethod(q_func(), [this] {
+            flush();
+        }, Qt::QueuedConnection);
+    }
+
+    void flush() {
+        flushScheduled = false;
+
+        const qint64 now = clock.elapsed();
+        qint64 nextTextUpdate = -1;
+        QList<WToplevelSurface*> limitedSurfaces;
+
+        for (auto surface : std::as_const(dirtySurfaces)) {
+            auto &state = states[surface];
+            auto handle = surfaces[surface].get();
+            Q_ASSERT(handle);
+
+            if (state.changes & TextChanges) {
+                const qint64 wait = state.lastTextUpdate < 0
+                                        ? 0
+                                        : state.lastTextUpdate + textUpdateInterval - now;
+                if (wait > 0) {
+                    // The client is spamming, delay the title and app_id to the next interval
+                    nextTextUpdate = nextTextUpdate < 0 ? wait : qMin(nextTextUpdate, wait);
+                    limitedSurfaces.append(surface);
+                } else {
+                    if (state.changes & TitleChange)
+                        updateTitle(surface, handle, state);
+                    if (state.changes & AppIdChange)
+                        updateAppId(surface, handle, state);
+                    state.lastTextUpdate = now;
+                    state.changes &= ~TextChanges;
+                }
+            }
+
+            if (state.changes & MinimizedChange)
+                handle->set_minimized(surface->isMinimized());
+            if (state.changes & MaximizedChange)
+                handle->set_maximized(surface->isMaximized());
+            if (state.changes & FullscreenChange)
+                handle->set_fullscreen(surface->isFullScreen());
+            if (state.changes & ActivatedChange)
+                handle->set_activated(surface->isActivated());
+            if (state.changes & ParentChange)
+                updateSurfaceParent(surface, handle);
+
+            state.changes &= TextChanges;
+        }
+
+        dirtySurfaces = limitedSurfaces;
+        if (nextTextUpdate > 0) {
+            if (!rateLimitTimer) {
+                rateLimitTimer = new QTimer(q_func());
+                rateLimitTimer->setSingleShot(true);
+                QObject::connect(rateLimitTimer, &QTimer::timeout, q_func(), [this] {
+                    flush();
+                });
+            }
+            rateLimitTimer->start(nextTextUpdate);
+        }
+    }
+
     void add(WToplevelSurface *surface) {
         W_Q(WForeignToplevel);
 
@@ -150,6 +274,13 @@ public:
 
         connections.erase(surface);
         surfaces.erase(surface);
+
+        auto state = states.find(surface);
+        if (state != states.end()) {
+            surfaceIndex.remove(state->second.surface);
+            states.erase(state);
+        }
+        dirtySurfaces.removeOne(surface);
     }
 
     void surfaceOutputEnter(WToplevelSurface *surface, WOutput *output) {
@@ -168,6 +299,13 @@ public:
 
     std::map<WToplevelSurface*, std::unique_ptr<qw_foreign_toplevel_handle_v1>> surfaces;
     std::map<WToplevelSurface*, std::vector<QMetaObject::Connection>> connections;
+    std::map<WToplevelSurface*, HandleState> states;
+    QHash<WSurface*, WToplevelSurface*> surfaceIndex;
+    QList<WToplevelSurface*> dirtySurfaces;
+    bool flushScheduled = false;
+    QTimer *rateLimitTimer = nullptr;
+    QElapsedTimer clock;
+    int textUpdateInterval = 100;
 };
 
 WForeignToplevel::WForeignToplevel(QObject *parent)
@@ -189,6 +327,22 @@ void WForeignToplevel::removeSurface(WToplevelSurface *surface)
     d->remove(surface);
 }
 
+int WForeignToplevel::textUpdateInterval() const
+{
+    W_DC(WForeignToplevel);
+    return d->textUpdateInterval;
+}
+
+void WForeignToplevel::setTextUpdateInterval(int msec)
+{
+    W_D(WForeignToplevel);
+    msec = qMax(0, msec);
+    if (d->textUpdateInterval == msec)
+        return;
+    d->textUpdateInterval = msec;
+    Q_EMIT textUpdateIntervalChanged();
+}
+
 QByteArrayView WForeignToplevel::interfaceName() const
 {
     return "zwlr_foreign_toplevel_manager_v1";
@@ -20,6 +20,8 @@ class WAYLIB_SERVER_EXPORT WForeignToplevel : public QObject, public WServerInte
 {
     Q_OBJECT
     W_DECLARE_PRIVATE(WForeignToplevel)
+    // The minimum interval(in milliseconds) to send the title and app_id of a toplevel
+    Q_PROPERTY(int textUpdateInterval READ textUpdateInterval WRITE setTextUpdateInterval NOTIFY textUpdateIntervalChanged FINAL)
 
 public:
     explicit WForeignToplevel(QObject *parent = nullptr);
@@ -27,6 +29,9 @@ public:
     void addSurface(WToplevelSurface *surface);
     void removeSurface(WToplevelSurface *surface);
 
+    int textUpdateInterval() const;
+    void setTextUpdateInterval(int msec);
+
     QByteArrayView interfaceName() const override;
 
 Q_SIGNALS:
@@ -36,6 +41,7 @@ Q_SIGNALS:
     void requestFullscreen(WToplevelSurface *surface, bool isFullscreen);
     void requestClose(WToplevelSurface *surface);
     void rectangleChanged(WToplevelSurface *surface, const QRect &rect);
+    void textUpdateIntervalChanged();
 
 private:
     void create(WServer *server) override;
@@ -0,0 +1,174 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wlinuxdrmsyncobjv1.h"
+#include "private/wglobal_p.h"
+
+#include <qwrenderer.h>
+#include <qwbackend.h>
+#include <qwcompositor.h>
+#include <qwdisplay.h>
+
+#include <QHash>
+#include <QPointer>
+#include <QLoggingCategory>
+
+#if WLR_VERSION_MINOR >= 18
+extern "C" {
+#include <wlr/types/wlr_linux_drm_syncobj_v1.h>
+}
+#endif
+
+#define LINUX_DRM_SYNCOBJ_MANAGER_V1_VERSION 1
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+Q_LOGGING_CATEGORY(wlcSyncobj, "waylib.server.syncobj", QtWarningMsg)
+
+class Q_DECL_HIDDEN WLinuxDrmSyncobjManagerV1Private : public WObjectPrivate
+{
+public:
+    WLinuxDrmSyncobjManagerV1Private(WLinuxDrmSyncobjManagerV1 *qq, qw_renderer *renderer, qw_compositor *compositor)
+        : WObjectPrivate(qq)
+        , renderer(renderer)
+        , compositor(compositor)
+    {
+
+    }
+
+    inline wlr_linux_drm_syncobj_manager_v1 *nativeHandle() const {
+        return q_func()->nativeInterface<wlr_linux_drm_syncobj_manager_v1>();
+    }
+
+    // begin slot function
+    void onNewSurface(qw_surface *surface);
+    // end slot function
+    void signalRelease(qw_surface *surface);
+
+    W_DECLARE_PUBLIC(WLinuxDrmSyncobjManagerV1)
+
+    QPointer<qw_renderer> renderer;
+    QPointer<qw_compositor> compositor;
+    QHash<qw_surface*, QMetaObject::Connection> surfaces;
+};
+
+void WLinuxDrmSyncobjManagerV1Private::onNewSurface(qw_surface *surface)
+{
+    W_Q(WLinuxDrmSyncobjManagerV1);
+
+    surfaces[surface] = QObject::connect(surface, &qw_surface::notify_commit, q, [this, surface] {
+        signalRelease(surface);
+    });
+    QObject::connect(surface, &qw_surface::before_destroy, q, [this, surface] {
+        QObject::disconnect(surfaces.take(surface));
+    });
+}
+
+void WLinuxDrmSyncobjManagerV1Private::signalRelease(qw_surface *surface)
+{
+#if WLR_VERSION_MINOR >= 18
+    auto s = surface->handle();
+    if (!(s->current.committed & WLR_SURFACE_STATE_BUFFER) || !s->buffer)
+        return;
+
+    auto state = wlr_linux_drm_syncobj_v1_get_surface_state(s);
+    if (!state || !state->release_timeline)
+        return;
+
+    // The buffer is locked by the WSurfaceItemContent while it's sampled in
+    // QtQuick, and by the output while it's scanned out, so the release point
+    // is signalled after the last user of the buffer is gone.
+    if (!wlr_linux_drm_syncobj_v1_state_signal_release_with_buffer(state, &s->buffer->base))
+        qCWarning(wlcSyncobj) << "Failed to signal the release point of" << surface;
+#else
+    Q_UNUSED(surface);
+#endif
+}
+
+WLinuxDrmSyncobjManagerV1::WLinuxDrmSyncobjManagerV1(qw_renderer *renderer, qw_compositor *compositor)
+    : WObject(*new WLinuxDrmSyncobjManagerV1Private(this, renderer, compositor))
+{
+
+}
+
+bool WLinuxDrmSyncobjManagerV1::isSupported(qw_renderer *renderer, qw_backend *backend)
+{
+#if WLR_VERSION_MINOR >= 18
+    return renderer->handle()->features.timeline
+           && backend->handle()->features.timeline
+           && wlr_renderer_get_drm_fd(renderer->handle()) >= 0;
+#else
+    Q_UNUSED(renderer);
+    Q_UNUSED(backend);
+    return false;
+#endif
+}
+
+wlr_linux_drm_syncobj_manager_v1 *WLinuxDrmSyncobjManagerV1::handle() const
+{
+    return nativeInterface<wlr_linux_drm_syncobj_manager_v1>();
+}
+
+QByteArrayView WLinuxDrmSyncobjManagerV1::interfaceName() const
+{
+    return "wp_linux_drm_syncobj_manager_v1";
+}
+
+void WLinuxDrmSyncobjManagerV1::create(WServer *server)
+{
+#if WLR_VERSION_MINOR >= 18
+    W_D(WLinuxDrmSyncobjManagerV1);
+
+    if (m_handle)
+        return;
+
+    Q_ASSERT(d->renderer && d->compositor);
+    const int drmFd = wlr_renderer_get_drm_fd(d->renderer->handle());
+    if (drmFd < 0) {
+        qCWarning(wlcSyncobj) << "The renderer has no DRM device, explicit sync is disabled";
+        return;
+    }
+
+    m_handle = wlr_linux_drm_syncobj_manager_v1_create(server->handle()->handle(),
+                                                       LINUX_DRM_SYNCOBJ_MANAGER_V1_VERSION,
+                                                       drmFd);
+    if (!m_handle) {
+        qCWarning(wlcSyncobj) << "Failed to create wp_linux_drm_syncobj_manager_v1";
+        return;
+    }
+
+    connect(d->compositor, &qw_compositor::notify_new_surface, this, [d] (wlr_surface *surface) {
+        d->onNewSurface(qw_surface::from(surface));
+    });
+#else
+    Q_UNUSED(server);
+    qCWarning(wlcSyncobj) << "wp_linux_drm_syncobj_manager_v1 requires wlroots 0.18";
+#endif
+}
+
+void WLinuxDrmSyncobjManagerV1::destroy(WServer *server)
+{
+    Q_UNUSED(server);
+    W_D(WLinuxDrmSyncobjManagerV1);
+
+    if (d->compositor)
+        d->compositor->disconnect(this);
+
+    for (const auto &connection : std::as_const(d->surfaces))
+        QObject::disconnect(connection);
+    d->surfaces.clear();
+}
+
+wl_global *WLinuxDrmSyncobjManagerV1::global() const
+{
+#if WLR_VERSION_MINOR >= 18
+    W_DC(WLinuxDrmSyncobjManagerV1);
+    if (m_handle)
+        return d->nativeHandle()->global;
+#endif
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
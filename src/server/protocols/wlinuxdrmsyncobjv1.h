@@ -0,0 +1,43 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <WServer>
+
+#include <QObject>
+
+struct wlr_linux_drm_syncobj_manager_v1;
+
+QW_BEGIN_NAMESPACE
+class qw_renderer;
+class qw_backend;
+class qw_compositor;
+QW_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WLinuxDrmSyncobjManagerV1Private;
+class WAYLIB_SERVER_EXPORT WLinuxDrmSyncobjManagerV1 : public QObject, public WObject, public WServerInterface
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WLinuxDrmSyncobjManagerV1)
+
+public:
+    explicit WLinuxDrmSyncobjManagerV1(QW_NAMESPACE::qw_renderer *renderer,
+                                       QW_NAMESPACE::qw_compositor *compositor);
+
+    // Requires wlroots 0.18, and both the renderer and the backend support timeline
+    static bool isSupported(QW_NAMESPACE::qw_renderer *renderer, QW_NAMESPACE::qw_backend *backend);
+
+    wlr_linux_drm_syncobj_manager_v1 *handle() const;
+
+    QByteArrayView interfaceName() const override;
+
+protected:
+    void create(WServer *server) override;
+    void destroy(WServer *server) override;
+    wl_global *global() const override;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
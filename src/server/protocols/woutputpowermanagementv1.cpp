@@ -0,0 +1,92 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "woutputpowermanagementv1.h"
+#include "woutput.h"
+#include "private/wglobal_p.h"
+
+#include <qwoutputpowermanagementv1.h>
+#include <qwoutput.h>
+#include <qwdisplay.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WOutputPowerManagerV1Private : public WObjectPrivate
+{
+public:
+    WOutputPowerManagerV1Private(WOutputPowerManagerV1 *qq)
+        : WObjectPrivate(qq)
+    {
+
+    }
+
+    inline qw_output_power_manager_v1 *handle() const {
+        return q_func()->nativeInterface<qw_output_power_manager_v1>();
+    }
+
+    inline wlr_output_power_manager_v1 *nativeHandle() const {
+        Q_ASSERT(handle());
+        return handle()->handle();
+    }
+
+    // begin slot function
+    void onSetMode(wlr_output_power_v1_set_mode_event *event);
+    // end slot function
+
+    W_DECLARE_PUBLIC(WOutputPowerManagerV1)
+};
+
+void WOutputPowerManagerV1Private::onSetMode(wlr_output_power_v1_set_mode_event *event)
+{
+    auto output = WOutput::fromHandle(qw_output::from(event->output));
+    if (!output)
+        return;
+
+    // wlroots sends the new mode to the clients on the output's commit
+    const bool on = event->mode == ZWLR_OUTPUT_POWER_V1_MODE_ON;
+    output->setPowerOn(on);
+    Q_EMIT q_func()->powerRequested(output, on);
+}
+
+WOutputPowerManagerV1::WOutputPowerManagerV1()
+    : WObject(*new WOutputPowerManagerV1Private(this))
+{
+
+}
+
+qw_output_power_manager_v1 *WOutputPowerManagerV1::handle() const
+{
+    return nativeInterface<qw_output_power_manager_v1>();
+}
+
+QByteArrayView WOutputPowerManagerV1::interfaceName() const
+{
+    return "zwlr_output_power_manager_v1";
+}
+
+void WOutputPowerManagerV1::create(WServer *server)
+{
+    W_D(WOutputPowerManagerV1);
+
+    if (m_handle)
+        return;
+
+    auto manager = qw_output_power_manager_v1::create(*server->handle());
+    m_handle = manager;
+    connect(manager, &qw_output_power_manager_v1::notify_set_mode, this,
+            [d] (wlr_output_power_v1_set_mode_event *event) {
+        d->onSetMode(event);
+    });
+}
+
+wl_global *WOutputPowerManagerV1::global() const
+{
+    W_DC(WOutputPowerManagerV1);
+    if (m_handle)
+        return d->nativeHandle()->global;
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
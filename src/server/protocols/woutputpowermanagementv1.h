@@ -0,0 +1,39 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <WServer>
+
+#include <QObject>
+
+QW_BEGIN_NAMESPACE
+class qw_output_power_manager_v1;
+QW_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WOutput;
+class WOutputPowerManagerV1Private;
+class WAYLIB_SERVER_EXPORT WOutputPowerManagerV1 : public QObject, public WObject, public WServerInterface
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WOutputPowerManagerV1)
+
+public:
+    explicit WOutputPowerManagerV1();
+
+    QW_NAMESPACE::qw_output_power_manager_v1 *handle() const;
+
+    QByteArrayView interfaceName() const override;
+
+Q_SIGNALS:
+    // Emitted after the request is applied by WOutput::setPowerOn
+    void powerRequested(WAYLIB_SERVER_NAMESPACE::WOutput *output, bool on);
+
+protected:
+    void create(WServer *server) override;
+    wl_global *global() const override;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -0,0 +1,112 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wpointerconstraintsv1.h"
+#include "wseat.h"
+#include "wsurface.h"
+#include "private/wglobal_p.h"
+
+#include <qwpointerconstraintsv1.h>
+#include <qwcompositor.h>
+#include <qwseat.h>
+#include <qwdisplay.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WPointerConstraintsV1Private : public WObjectPrivate
+{
+public:
+    WPointerConstraintsV1Private(WPointerConstraintsV1 *qq)
+        : WObjectPrivate(qq)
+    {
+
+    }
+
+    inline qw_pointer_constraints_v1 *handle() const {
+        return q_func()->nativeInterface<qw_pointer_constraints_v1>();
+    }
+
+    inline wlr_pointer_constraints_v1 *nativeHandle() const {
+        Q_ASSERT(handle());
+        return handle()->handle();
+    }
+
+    // begin slot function
+    void onNewConstraint(wlr_pointer_constraint_v1 *constraint);
+    // end slot function
+
+    W_DECLARE_PUBLIC(WPointerConstraintsV1)
+};
+
+void WPointerConstraintsV1Private::onNewConstraint(wlr_pointer_constraint_v1 *constraint)
+{
+    W_Q(WPointerConstraintsV1);
+
+    auto seat = WSeat::fromHandle(qw_seat::from(constraint->seat));
+    if (!seat)
+        return;
+
+    auto qconstraint = qw_pointer_constraint_v1::from(constraint);
+    QObject::connect(qconstraint, &qw_pointer_constraint_v1::before_destroy, seat, [seat, constraint] {
+        seat->removePointerConstraint(constraint);
+    });
+
+    // Activate at once if the surface has the pointer focus, otherwise
+    // it's activated when the surface gets the pointer focus.
+    seat->updatePointerConstraint();
+
+    if (auto surface = WSurface::fromHandle(constraint->surface))
+        Q_EMIT q->constraintCreated(seat, surface);
+}
+
+WPointerConstraintsV1::WPointerConstraintsV1()
+    : WObject(*new WPointerConstraintsV1Private(this))
+{
+
+}
+
+qw_pointer_constraints_v1 *WPointerConstraintsV1::handle() const
+{
+    return nativeInterface<qw_pointer_constraints_v1>();
+}
+
+QByteArrayView WPointerConstraintsV1::interfaceName() const
+{
+    return "zwp_pointer_constraints_v1";
+}
+
+wlr_pointer_constraint_v1 *WPointerConstraintsV1::constraintForSurface(WSeat *seat, WSurface *surface) const
+{
+    W_DC(WPointerConstraintsV1);
+    if (!m_handle || !seat || !surface)
+        return nullptr;
+
+    return wlr_pointer_constraints_v1_constraint_for_surface(d->nativeHandle(),
+                                                             surface->handle()->handle(),
+                                                             seat->nativeHandle());
+}
+
+void WPointerConstraintsV1::create(WServer *server)
+{
+    W_D(WPointerConstraintsV1);
+
+    if (!m_handle) {
+        m_handle = qw_pointer_constraints_v1::create(*server->handle());
+        connect(d->handle(), &qw_pointer_constraints_v1::notify_new_constraint, this,
+                [d] (wlr_pointer_constraint_v1 *constraint) {
+            d->onNewConstraint(constraint);
+        });
+    }
+}
+
+wl_global *WPointerConstraintsV1::global() const
+{
+    W_DC(WPointerConstraintsV1);
+    if (m_handle)
+        return d->nativeHandle()->global;
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
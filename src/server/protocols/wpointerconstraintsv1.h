@@ -0,0 +1,43 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <WServer>
+
+#include <QObject>
+
+QW_BEGIN_NAMESPACE
+class qw_pointer_constraints_v1;
+QW_END_NAMESPACE
+
+struct wlr_pointer_constraint_v1;
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WSeat;
+class WSurface;
+class WPointerConstraintsV1Private;
+class WAYLIB_SERVER_EXPORT WPointerConstraintsV1 : public QObject, public WObject, public WServerInterface
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WPointerConstraintsV1)
+
+public:
+    explicit WPointerConstraintsV1();
+
+    QW_NAMESPACE::qw_pointer_constraints_v1 *handle() const;
+
+    QByteArrayView interfaceName() const override;
+
+    wlr_pointer_constraint_v1 *constraintForSurface(WSeat *seat, WSurface *surface) const;
+
+Q_SIGNALS:
+    void constraintCreated(WAYLIB_SERVER_NAMESPACE::WSeat *seat, WAYLIB_SERVER_NAMESPACE::WSurface *surface);
+
+protected:
+    void create(WServer *server) override;
+    wl_global *global() const override;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
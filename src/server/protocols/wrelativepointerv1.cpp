@@ -0,0 +1,89 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wrelativepointerv1.h"
+#include "wseat.h"
+#include "private/wglobal_p.h"
+
+#include <qwrelativepointerv1.h>
+#include <qwseat.h>
+#include <qwdisplay.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WRelativePointerManagerV1Private : public WObjectPrivate
+{
+public:
+    WRelativePointerManagerV1Private(WRelativePointerManagerV1 *qq)
+        : WObjectPrivate(qq)
+    {
+
+    }
+
+    inline qw_relative_pointer_manager_v1 *handle() const {
+        return q_func()->nativeInterface<qw_relative_pointer_manager_v1>();
+    }
+
+    inline wlr_relative_pointer_manager_v1 *nativeHandle() const {
+        Q_ASSERT(handle());
+        return handle()->handle();
+    }
+
+    W_DECLARE_PUBLIC(WRelativePointerManagerV1)
+};
+
+WRelativePointerManagerV1::WRelativePointerManagerV1()
+    : WObject(*new WRelativePointerManagerV1Private(this))
+{
+
+}
+
+qw_relative_pointer_manager_v1 *WRelativePointerManagerV1::handle() const
+{
+    return nativeInterface<qw_relative_pointer_manager_v1>();
+}
+
+QByteArrayView WRelativePointerManagerV1::interfaceName() const
+{
+    return "zwp_relative_pointer_manager_v1";
+}
+
+void WRelativePointerManagerV1::sendRelativeMotion(WSeat *seat, uint64_t timeUsec,
+                                                   const QPointF &delta, const QPointF &unaccelDelta)
+{
+    W_D(WRelativePointerManagerV1);
+    if (!m_handle)
+        return;
+
+    // Sent to the relative pointers of the seat's pointer focus client only
+    wlr_relative_pointer_manager_v1_send_relative_motion(d->nativeHandle(), seat->nativeHandle(),
+                                                         timeUsec, delta.x(), delta.y(),
+                                                         unaccelDelta.x(), unaccelDelta.y());
+}
+
+void WRelativePointerManagerV1::create(WServer *server)
+{
+    if (!m_handle)
+        m_handle = qw_relative_pointer_manager_v1::create(*server->handle());
+
+    for (auto seat : server->findInterfaces<WSeat>())
+        seat->setRelativePointerManager(this);
+}
+
+void WRelativePointerManagerV1::destroy(WServer *server)
+{
+    for (auto seat : server->findInterfaces<WSeat>())
+        seat->setRelativePointerManager(nullptr);
+}
+
+wl_global *WRelativePointerManagerV1::global() const
+{
+    W_DC(WRelativePointerManagerV1);
+    if (m_handle)
+        return d->nativeHandle()->global;
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
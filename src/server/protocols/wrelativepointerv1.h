@@ -0,0 +1,39 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <WServer>
+
+#include <QObject>
+
+QW_BEGIN_NAMESPACE
+class qw_relative_pointer_manager_v1;
+QW_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WSeat;
+class WRelativePointerManagerV1Private;
+class WAYLIB_SERVER_EXPORT WRelativePointerManagerV1 : public QObject, public WObject, public WServerInterface
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WRelativePointerManagerV1)
+
+public:
+    explicit WRelativePointerManagerV1();
+
+    QW_NAMESPACE::qw_relative_pointer_manager_v1 *handle() const;
+
+    QByteArrayView interfaceName() const override;
+
+    void sendRelativeMotion(WSeat *seat, uint64_t timeUsec,
+                            const QPointF &delta, const QPointF &unaccelDelta);
+
+protected:
+    void create(WServer *server) override;
+    void destroy(WServer *server) override;
+    wl_global *global() const override;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
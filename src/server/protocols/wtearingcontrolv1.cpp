@@ -0,0 +1,133 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wtearingcontrolv1.h"
+#include "wsurface.h"
+#include "private/wsurface_p.h"
+#include "private/wglobal_p.h"
+
+#include <qwtearingcontrolv1.h>
+#include <qwcompositor.h>
+#include <qwdisplay.h>
+
+#include <QHash>
+
+#define TEARING_CONTROL_MANAGER_V1_VERSION 1
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WTearingControlManagerV1Private : public WObjectPrivate
+{
+public:
+    WTearingControlManagerV1Private(WTearingControlManagerV1 *qq)
+        : WObjectPrivate(qq)
+    {
+
+    }
+
+    inline qw_tearing_control_manager_v1 *handle() const {
+        return q_func()->nativeInterface<qw_tearing_control_manager_v1>();
+    }
+
+    inline wlr_tearing_control_manager_v1 *nativeHandle() const {
+        Q_ASSERT(handle());
+        return handle()->handle();
+    }
+
+    // begin slot function
+    void onNewObject(wlr_tearing_control_v1 *control);
+    // end slot function
+    void updateHint(qw_surface *surface);
+
+    W_DECLARE_PUBLIC(WTearingControlManagerV1)
+
+    QHash<qw_surface*, QMetaObject::Connection> surfaces;
+};
+
+void WTearingControlManagerV1Private::onNewObject(wlr_tearing_control_v1 *control)
+{
+    W_Q(WTearingControlManagerV1);
+
+    auto surface = qw_surface::from(control->surface);
+    if (!surfaces.contains(surface)) {
+        // The hint is double-buffered state of the wl_surface, it's applied
+        // on the surface's commit, and it's reset to vsync on the object's destroy,
+        // the client must commit the surface after that to take effect.
+        surfaces[surface] = QObject::connect(surface, &qw_surface::notify_commit, q, [this, surface] {
+            updateHint(surface);
+        });
+        QObject::connect(surface, &qw_surface::before_destroy, q, [this, surface] {
+            QObject::disconnect(surfaces.take(surface));
+        });
+    }
+
+    updateHint(surface);
+}
+
+void WTearingControlManagerV1Private::updateHint(qw_surface *surface)
+{
+    auto wsurface = WSurface::fromHandle(surface);
+    // Maybe the WSurface is not created yet, will update on the next commit
+    if (!wsurface)
+        return;
+
+    const auto hint = wlr_tearing_control_manager_v1_surface_hint_from_surface(nativeHandle(),
+                                                                               surface->handle());
+    const bool allowed = hint == WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC;
+    if (wsurface->tearingAllowed() == allowed)
+        return;
+
+    WSurfacePrivate::get(wsurface)->setTearingAllowed(allowed);
+    Q_EMIT q_func()->hintChanged(wsurface);
+}
+
+WTearingControlManagerV1::WTearingControlManagerV1()
+    : WObject(*new WTearingControlManagerV1Private(this))
+{
+
+}
+
+qw_tearing_control_manager_v1 *WTearingControlManagerV1::handle() const
+{
+    return nativeInterface<qw_tearing_control_manager_v1>();
+}
+
+QByteArrayView WTearingControlManagerV1::interfaceName() const
+{
+    return "wp_tearing_control_manager_v1";
+}
+
+void WTearingControlManagerV1::create(WServer *server)
+{
+    W_D(WTearingControlManagerV1);
+
+    if (!m_handle) {
+        m_handle = qw_tearing_control_manager_v1::create(*server->handle(), TEARING_CONTROL_MANAGER_V1_VERSION);
+        connect(d->handle(), &qw_tearing_control_manager_v1::notify_new_object, this,
+                [d] (wlr_tearing_control_v1 *control) {
+            d->onNewObject(control);
+        });
+    }
+}
+
+void WTearingControlManagerV1::destroy(WServer *server)
+{
+    Q_UNUSED(server);
+    W_D(WTearingControlManagerV1);
+
+    for (const auto &connection : std::as_const(d->surfaces))
+        QObject::disconnect(connection);
+    d->surfaces.clear();
+}
+
+wl_global *WTearingControlManagerV1::global() const
+{
+    W_DC(WTearingControlManagerV1);
+    if (m_handle)
+        return d->nativeHandle()->global;
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
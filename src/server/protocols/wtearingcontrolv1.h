@@ -0,0 +1,39 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <WServer>
+
+#include <QObject>
+
+QW_BEGIN_NAMESPACE
+class qw_tearing_control_manager_v1;
+QW_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WSurface;
+class WTearingControlManagerV1Private;
+class WAYLIB_SERVER_EXPORT WTearingControlManagerV1 : public QObject, public WObject, public WServerInterface
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WTearingControlManagerV1)
+
+public:
+    explicit WTearingControlManagerV1();
+
+    QW_NAMESPACE::qw_tearing_control_manager_v1 *handle() const;
+
+    QByteArrayView interfaceName() const override;
+
+Q_SIGNALS:
+    void hintChanged(WAYLIB_SERVER_NAMESPACE::WSurface *surface);
+
+protected:
+    void create(WServer *server) override;
+    void destroy(WServer *server) override;
+    wl_global *global() const override;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
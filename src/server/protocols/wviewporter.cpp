@@ -0,0 +1,68 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wviewporter.h"
+#include "private/wglobal_p.h"
+
+#include <qwviewporter.h>
+#include <qwdisplay.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WViewporterPrivate : public WObjectPrivate
+{
+public:
+    WViewporterPrivate(WViewporter *qq)
+        : WObjectPrivate(qq)
+    {
+
+    }
+
+    inline qw_viewporter *handle() const {
+        return q_func()->nativeInterface<qw_viewporter>();
+    }
+
+    inline wlr_viewporter *nativeHandle() const {
+        Q_ASSERT(handle());
+        return handle()->handle();
+    }
+
+    W_DECLARE_PUBLIC(WViewporter)
+};
+
+WViewporter::WViewporter()
+    : WObject(*new WViewporterPrivate(this))
+{
+
+}
+
+qw_viewporter *WViewporter::handle() const
+{
+    return nativeInterface<qw_viewporter>();
+}
+
+QByteArrayView WViewporter::interfaceName() const
+{
+    return "wp_viewporter";
+}
+
+void WViewporter::create(WServer *server)
+{
+    // wlroots applies the viewport to the surface state, the crop is in
+    // WSurface::bufferSourceBox and the destination size is WSurface::size,
+    // so the buffer is scaled when it's sampled or scanned out.
+    if (!m_handle)
+        m_handle = qw_viewporter::create(*server->handle());
+}
+
+wl_global *WViewporter::global() const
+{
+    W_DC(WViewporter);
+    if (m_handle)
+        return d->nativeHandle()->global;
+
+    return nullptr;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
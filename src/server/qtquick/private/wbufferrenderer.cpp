@@ -248,6 +248,50 @@ qw_buffer *WBufferRenderer::lastBuffer() const
     return m_lastBuffer;
 }
 
+int WBufferRenderer::acquiredBufferCount() const
+{
+    if (!m_swapchain)
+        return 0;
+
+    // The buffers are held by the renderer, the output or the pending page flip
+    int count = 0;
+    for (const auto &slot : m_swapchain->handle()->slots) {
+        if (slot.buffer && slot.acquired)
+            ++count;
+    }
+
+    return count;
+}
+
+static inline qint64 bufferBytes(const wlr_buffer *buffer, uint32_t format)
+{
+    return qRound64(qint64(buffer->width) * buffer->height * WTools::drmFormatBytesPerPixel(format));
+}
+
+qint64 WBufferRenderer::allocatedBytes(int *bufferCount) const
+{
+    qint64 bytes = 0;
+    int count = 0;
+    if (m_swapchain) {
+        const auto sc = m_swapchain->handle();
+        for (const auto &slot : sc->slots) {
+            if (!slot.buffer)
+                continue;
+            bytes += bufferBytes(slot.buffer, sc->format.format);
+            ++count;
+        }
+    }
+
+    if (bufferCount)
+        *bufferCount = count;
+    return bytes;
+}
+
+qint64 WBufferRenderer::idleMsecs() const
+{
+    return m_lastRenderTimer.isValid() ? m_lastRenderTimer.elapsed() : -1;
+}
+
 QRhiTexture *WBufferRenderer::currentRenderTarget() const
 {
     auto textureRT = static_cast<QRhiTextureRenderTarget*>(state.sgRenderTarget.rt);
@@ -597,6 +641,60 @@ void WBufferRenderer::render(int sourceIndex, const QMatrix4x4 &renderMatrix,
         wTextureProvider()->setBuffer(state.buffer);
 }
 
+bool WBufferRenderer::paintBuffers(const QList<std::pair<qw_buffer*, QRect>> &buffers)
+{
+    Q_ASSERT(state.buffer);
+
+    auto softwareRenderer = dynamic_cast<QSGSoftwareRenderer*>(state.renderer);
+    if (!softwareRenderer)
+        return false;
+
+    QList<std::pair<QImage, QRect>> images;
+    images.reserve(buffers.size());
+    bool ok = true;
+
+    for (const auto &[buffer, rect] : buffers) {
+        void *data = nullptr;
+        uint32_t format = DRM_FORMAT_INVALID;
+        size_t stride = 0;
+        if (!wlr_buffer_begin_data_ptr_access(buffer->handle(), WLR_BUFFER_DATA_PTR_ACCESS_READ,
+                                              &data, &format, &stride)) {
+            ok = false;
+            break;
+        }
+
+        const QImage image(reinterpret_cast<const uchar*>(data), buffer->handle()->width,
+                           buffer->handle()->height, stride, WTools::toImageFormat(format));
+        images.append({image, rect});
+        if (image.isNull()) {
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok) {
+        auto currentImage = getImageFrom(state.renderTarget);
+        PixmanRegion damage;
+        QPainter pa(currentImage);
+
+        for (const auto &[image, rect] : std::as_const(images)) {
+            pa.drawImage(rect, image);
+            pixman_region32_union_rect(damage, damage, rect.x(), rect.y(), rect.width(), rect.height());
+        }
+
+        pa.end();
+        m_damageRing.add(damage);
+        // The pixels under the buffers are lost, and QSGSoftwareRenderer can't
+        // repaint only that region, so the next frame is a full repaint.
+        softwareRenderer->markDirty();
+    }
+
+    for (int i = 0; i < images.size(); ++i)
+        wlr_buffer_end_data_ptr_access(buffers.at(i).first->handle());
+
+    return ok;
+}
+
 void WBufferRenderer::endRender()
 {
     Q_ASSERT(state.buffer);
@@ -605,6 +703,7 @@ void WBufferRenderer::endRender()
     state.renderer = nullptr;
 
     m_lastBuffer = buffer;
+    m_lastRenderTimer.start();
     m_damageRing.rotate();
     m_swapchain->set_buffer_submitted(*buffer);
     buffer->unlock();
@@ -622,6 +721,47 @@ void WBufferRenderer::endRender()
     Q_EMIT afterRendering();
 }
 
+void WBufferRenderer::releaseBuffers()
+{
+    Q_ASSERT(!state.buffer);
+    resetTextureProvider();
+    m_lastBuffer = nullptr;
+    state.lastRT = {};
+
+    // The render targets are bound to the buffers of the swapchain
+    delete m_renderHelper;
+    m_renderHelper = nullptr;
+    delete m_swapchain;
+    m_swapchain = nullptr;
+
+    m_damageRing.add_whole();
+}
+
+qint64 WBufferRenderer::trimBuffers()
+{
+    if (!m_swapchain || state.buffer)
+        return 0;
+
+    qint64 freed = 0;
+    auto sc = m_swapchain->handle();
+    for (auto &slot : sc->slots) {
+        if (!slot.buffer || slot.acquired)
+            continue;
+        // Keep the last buffer for the cached texture and the buffer age
+        if (m_lastBuffer && slot.buffer == m_lastBuffer->handle())
+            continue;
+
+        freed += bufferBytes(slot.buffer, sc->format.format);
+        // Same as slot_reset of wlroots, the release listener is only
+        // linked while the slot is acquired. The next frame in a new slot
+        // gets a buffer age of 0, so it's fully repainted.
+        wlr_buffer_drop(slot.buffer);
+        slot = {};
+    }
+
+    return freed;
+}
+
 void WBufferRenderer::componentComplete()
 {
     QQuickItem::componentComplete();
@@ -10,6 +10,7 @@
 
 #include <QQuickItem>
 #include <QQuickRenderTarget>
+#include <QElapsedTimer>
 #define protected public
 #include <private/qsgrenderer_p.h>
 #undef protected
@@ -71,6 +72,11 @@ public:
     const QMatrix4x4 &currentWorldTransform() const;
     QW_NAMESPACE::qw_buffer *currentBuffer() const;
     QW_NAMESPACE::qw_buffer *lastBuffer() const;
+    int acquiredBufferCount() const;
+    // The memory of the buffers allocated in the swapchain
+    qint64 allocatedBytes(int *bufferCount = nullptr) const;
+    // The time since the last frame was rendered, -1 if never rendered
+    qint64 idleMsecs() const;
     QRhiTexture *currentRenderTarget() const;
     const QW_NAMESPACE::qw_damage_ring *damageRing() const;
     QW_NAMESPACE::qw_damage_ring *damageRing();
@@ -96,6 +102,13 @@ protected:
                 const QRectF &sourceRect = {}, const QRectF &targetRect = {},
                 bool preserveColorContents = false);
     void endRender();
+    // Only for the software renderer, the buffers are painted in order
+    bool paintBuffers(const QList<std::pair<QW_NAMESPACE::qw_buffer*, QRect>> &buffers);
+    // Destroys the swapchain, the next frame is fully repainted in a new one
+    void releaseBuffers();
+    // Frees the swapchain's buffers except the last rendered one and the
+    // buffers still in use, returns the freed bytes
+    qint64 trimBuffers();
     void componentComplete() override;
 
 private:
@@ -106,6 +119,9 @@ private:
     inline bool shouldCacheBuffer() const {
         return m_cacheBuffer || !m_cacheBufferLocker.isEmpty();
     }
+    inline bool isCacheBufferLocked() const {
+        return !m_cacheBufferLocker.isEmpty();
+    }
 
     void resetTextureProvider();
     void updateTextureProvider();
@@ -127,6 +143,7 @@ private:
     QW_NAMESPACE::qw_swapchain *m_swapchain = nullptr;
     WRenderHelper *m_renderHelper = nullptr;
     QPointer<QW_NAMESPACE::qw_buffer> m_lastBuffer;
+    QElapsedTimer m_lastRenderTimer;
 
     struct RenderState {
         RenderFlags flags;
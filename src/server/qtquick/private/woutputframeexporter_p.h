@@ -0,0 +1,60 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include "woutputframeexporter.h"
+#include "private/wglobal_p.h"
+
+#include <QPointer>
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WBufferRenderer;
+class Q_DECL_HIDDEN WOutputFrameExporterPrivate : public WObjectPrivate
+{
+public:
+    WOutputFrameExporterPrivate(WOutputFrameExporter *qq, WOutputViewport *viewport);
+    ~WOutputFrameExporterPrivate();
+
+    inline static WOutputFrameExporterPrivate *get(WOutputFrameExporter *exporter) {
+        return exporter->d_func();
+    }
+
+    // call in WOutputRenderWindow after the frame is committed
+    void onFrameCommitted(WBufferRenderer *renderer, QW_NAMESPACE::qw_buffer *buffer,
+                          const QRegion &damage);
+    void onCursorUpdated(QW_NAMESPACE::qw_buffer *buffer, const QPoint &position,
+                         const QPoint &hotSpot);
+
+    void setBuffer(QW_NAMESPACE::qw_buffer *newBuffer);
+    void setCursorBuffer(QW_NAMESPACE::qw_buffer *newBuffer);
+
+    W_DECLARE_PUBLIC(WOutputFrameExporter)
+
+    QPointer<WOutputViewport> viewport;
+    bool cursorAsMetadata = false;
+
+    QW_NAMESPACE::qw_buffer *buffer = nullptr;
+    // The damage of the last buffer is relative to the previous frame of this renderer
+    WBufferRenderer *lastRenderer = nullptr;
+    QSize lastSize;
+    quint64 frameSequence = 0;
+    QRegion damage;
+
+    // for the CPU mapping of the dmabuf
+    enum AccessType {
+        NoAccess,
+        DataPtrAccess,
+        DmabufMapAccess,
+    } access = NoAccess;
+    void *mappedData = nullptr;
+    size_t mappedSize = 0;
+    int mappedFd = -1;
+
+    QW_NAMESPACE::qw_buffer *cursorBuffer = nullptr;
+    QPoint cursorPosition;
+    QPoint cursorHotSpot;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -6,6 +6,7 @@
 #include "woutputviewport.h"
 #include "woutputrenderwindow.h"
 #include "wbufferrenderer_p.h"
+#include "woutputframeexporter.h"
 
 #include <qwoutput.h>
 #include <qwtexture.h>
@@ -81,6 +82,16 @@ public:
     QPointer<QQuickItem> extraRenderSource;
     QRectF sourceRect;
     QRectF targetRect;
+    WOutputViewport::TearingPolicy tearingPolicy = WOutputViewport::NoTearing;
+    WOutputViewport::VrrPolicy vrrPolicy = WOutputViewport::NoVrr;
+    // In Hz, the other contents are flushed at least this rate in VRR mode
+    int minimumRefreshRate = 30;
+    // The buffers of the swapchain may be in use at once, more than 2 allows
+    // to render the next frame while the page flip of the last one is pending.
+    int swapchainDepth = 2;
+    // Shows the buffer of this viewport instead of rendering the input
+    QPointer<WOutputViewport> mirrorSource;
+    QList<WOutputFrameExporter*> frameExporters;
 
     uint attached:1;
     uint offscreen:1;
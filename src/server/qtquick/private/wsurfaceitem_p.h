@@ -38,6 +38,14 @@ public:
     void updateContentPosition();
     WSurfaceItem *ensureSubsurfaceItem(WSurface *subsurfaceSurface);
 
+    inline bool flattenSubsurfaces() const {
+        return !delegate && surfaceFlags.testFlag(WSurfaceItem::FlattenSubsurfaces);
+    }
+    void updateFlattenSubsurfaces();
+    WSurface *surfaceAt(const QPointF &position, QPointF *localPosition) const;
+    QObject *eventObjectOf(WSurface *target);
+    bool sendSurfaceTreeEvent(QSinglePointEvent *event);
+
     void resizeSurfaceToItemSize(const QSize &itemSize, const QSize &sizeDiff);
     void updateEventItem(bool forceDestroy);
     void updateEventItemGeometry();
@@ -74,6 +82,12 @@ public:
     qreal surfaceSizeRatio = 1.0;
     bool live = true;
 
+    // The pointer target in the flattened surface tree, and its offset from
+    // the root surface.
+    QPointer<WSurface> pointerTarget;
+    QPointF pointerTargetOffset;
+    QHash<WSurface*, QObject*> subsurfaceEventObjects;
+
     uint32_t beforeRequestResizeSurfaceStateSeq = 0;
 };
 
@@ -0,0 +1,299 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "woutputframeexporter.h"
+#include "private/woutputframeexporter_p.h"
+#include "woutputviewport.h"
+#include "woutputviewport_p.h"
+#include "wtools.h"
+
+#include <qwbuffer.h>
+
+#include <QLoggingCategory>
+
+#include <cerrno>
+#include <cstring>
+#include <drm_fourcc.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+Q_LOGGING_CATEGORY(qLcFrameExporter, "waylib.server.frame.exporter", QtWarningMsg)
+
+static bool syncDmabuf(int fd, quint64 flags)
+{
+    dma_buf_sync sync = { .flags = flags };
+    int ret;
+    do {
+        ret = ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+    return ret == 0;
+}
+
+WOutputFrameExporterPrivate::WOutputFrameExporterPrivate(WOutputFrameExporter *qq, WOutputViewport *viewport)
+    : WObjectPrivate(qq)
+    , viewport(viewport)
+{
+
+}
+
+WOutputFrameExporterPrivate::~WOutputFrameExporterPrivate()
+{
+    Q_ASSERT(access == NoAccess);
+    setBuffer(nullptr);
+    setCursorBuffer(nullptr);
+}
+
+void WOutputFrameExporterPrivate::onFrameCommitted(WBufferRenderer *renderer, qw_buffer *newBuffer,
+                                                   const QRegion &newDamage)
+{
+    W_Q(WOutputFrameExporter);
+
+    const QSize size(newBuffer->handle()->width, newBuffer->handle()->height);
+    if (renderer != lastRenderer || size != lastSize) {
+        // The damage isn't relative to the last exported frame
+        damage = QRect(QPoint(0, 0), size);
+    } else {
+        damage += newDamage;
+    }
+
+    lastRenderer = renderer;
+    lastSize = size;
+
+    if (access != NoAccess) {
+        qCWarning(qLcFrameExporter) << "The last frame is still accessed, the new frame isn't exported";
+        return;
+    }
+
+    setBuffer(newBuffer);
+    ++frameSequence;
+    Q_EMIT q->frameCommitted();
+}
+
+void WOutputFrameExporterPrivate::onCursorUpdated(qw_buffer *newBuffer, const QPoint &position,
+                                                  const QPoint &hotSpot)
+{
+    if (cursorBuffer == newBuffer && cursorPosition == position && cursorHotSpot == hotSpot)
+        return;
+
+    setCursorBuffer(newBuffer);
+    cursorPosition = position;
+    cursorHotSpot = hotSpot;
+    Q_EMIT q_func()->cursorChanged();
+}
+
+void WOutputFrameExporterPrivate::setBuffer(qw_buffer *newBuffer)
+{
+    if (buffer == newBuffer)
+        return;
+    if (buffer)
+        buffer->unlock();
+    buffer = newBuffer;
+    if (buffer)
+        buffer->lock();
+}
+
+void WOutputFrameExporterPrivate::setCursorBuffer(qw_buffer *newBuffer)
+{
+    if (cursorBuffer == newBuffer)
+        return;
+    if (cursorBuffer)
+        cursorBuffer->unlock();
+    cursorBuffer = newBuffer;
+    if (cursorBuffer)
+        cursorBuffer->lock();
+}
+
+WOutputFrameExporter::WOutputFrameExporter(WOutputViewport *viewport, QObject *parent)
+    : QObject(parent)
+    , WObject(*new WOutputFrameExporterPrivate(this, viewport))
+{
+    Q_ASSERT(viewport);
+    WOutputViewportPrivate::get(viewport)->frameExporters.append(this);
+}
+
+WOutputFrameExporter::~WOutputFrameExporter()
+{
+    W_D(WOutputFrameExporter);
+    endAccess();
+
+    if (d->viewport) {
+        auto viewportD = WOutputViewportPrivate::get(d->viewport);
+        viewportD->frameExporters.removeOne(this);
+        if (d->cursorAsMetadata)
+            viewportD->update();
+    }
+}
+
+WOutputViewport *WOutputFrameExporter::viewport() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->viewport;
+}
+
+bool WOutputFrameExporter::cursorAsMetadata() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->cursorAsMetadata;
+}
+
+void WOutputFrameExporter::setCursorAsMetadata(bool on)
+{
+    W_D(WOutputFrameExporter);
+    if (d->cursorAsMetadata == on)
+        return;
+    d->cursorAsMetadata = on;
+    if (!on)
+        d->setCursorBuffer(nullptr);
+    if (d->viewport)
+        WOutputViewportPrivate::get(d->viewport)->update();
+    Q_EMIT cursorAsMetadataChanged();
+}
+
+qw_buffer *WOutputFrameExporter::buffer() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->buffer;
+}
+
+quint64 WOutputFrameExporter::frameSequence() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->frameSequence;
+}
+
+QRegion WOutputFrameExporter::takeDamage()
+{
+    W_D(WOutputFrameExporter);
+    return std::exchange(d->damage, {});
+}
+
+void WOutputFrameExporter::releaseFrame()
+{
+    W_D(WOutputFrameExporter);
+    endAccess();
+    d->setBuffer(nullptr);
+}
+
+bool WOutputFrameExporter::beginAccess(const uchar **data, uint32_t *format, size_t *stride)
+{
+    W_D(WOutputFrameExporter);
+    if (!d->buffer || d->access != WOutputFrameExporterPrivate::NoAccess)
+        return false;
+
+    void *ptr = nullptr;
+    if (wlr_buffer_begin_data_ptr_access(d->buffer->handle(), WLR_BUFFER_DATA_PTR_ACCESS_READ,
+                                         &ptr, format, stride)) {
+        d->access = WOutputFrameExporterPrivate::DataPtrAccess;
+        *data = static_cast<const uchar*>(ptr);
+        return true;
+    }
+
+    // Map the linear dmabuf of the GPU, the tiled buffers need the GPU to read
+    wlr_dmabuf_attributes attribs;
+    if (!wlr_buffer_get_dmabuf(d->buffer->handle(), &attribs)
+        || attribs.n_planes != 1 || attribs.modifier != DRM_FORMAT_MOD_LINEAR) {
+        return false;
+    }
+
+    const size_t size = size_t(attribs.offset[0]) + size_t(attribs.stride[0]) * attribs.height;
+    ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, attribs.fd[0], 0);
+    if (ptr == MAP_FAILED) {
+        qCWarning(qLcFrameExporter) << "Can't map the dmabuf:" << strerror(errno);
+        return false;
+    }
+
+    syncDmabuf(attribs.fd[0], DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+
+    d->access = WOutputFrameExporterPrivate::DmabufMapAccess;
+    d->mappedData = ptr;
+    d->mappedSize = size;
+    d->mappedFd = attribs.fd[0];
+
+    *data = static_cast<const uchar*>(ptr) + attribs.offset[0];
+    *format = attribs.format;
+    *stride = attribs.stride[0];
+    return true;
+}
+
+void WOutputFrameExporter::endAccess()
+{
+    W_D(WOutputFrameExporter);
+    switch (d->access) {
+    case WOutputFrameExporterPrivate::NoAccess:
+        return;
+    case WOutputFrameExporterPrivate::DataPtrAccess:
+        wlr_buffer_end_data_ptr_access(d->buffer->handle());
+        break;
+    case WOutputFrameExporterPrivate::DmabufMapAccess:
+        syncDmabuf(d->mappedFd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+        munmap(d->mappedData, d->mappedSize);
+        d->mappedData = nullptr;
+        d->mappedSize = 0;
+        d->mappedFd = -1;
+        break;
+    }
+
+    d->access = WOutputFrameExporterPrivate::NoAccess;
+}
+
+bool WOutputFrameExporter::dmabuf(wlr_dmabuf_attributes *attribs) const
+{
+    W_DC(WOutputFrameExporter);
+    return d->buffer && wlr_buffer_get_dmabuf(d->buffer->handle(), attribs);
+}
+
+bool WOutputFrameExporter::hasCursor() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->cursorBuffer;
+}
+
+QPoint WOutputFrameExporter::cursorPosition() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->cursorPosition;
+}
+
+QPoint WOutputFrameExporter::cursorHotSpot() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->cursorHotSpot;
+}
+
+qw_buffer *WOutputFrameExporter::cursorBuffer() const
+{
+    W_DC(WOutputFrameExporter);
+    return d->cursorBuffer;
+}
+
+QImage WOutputFrameExporter::cursorImage() const
+{
+    W_DC(WOutputFrameExporter);
+    if (!d->cursorBuffer)
+        return {};
+
+    void *data = nullptr;
+    uint32_t format = DRM_FORMAT_INVALID;
+    size_t stride = 0;
+    if (!wlr_buffer_begin_data_ptr_access(d->cursorBuffer->handle(), WLR_BUFFER_DATA_PTR_ACCESS_READ,
+                                          &data, &format, &stride)) {
+        return {};
+    }
+
+    const QImage image(static_cast<const uchar*>(data), d->cursorBuffer->handle()->width,
+                       d->cursorBuffer->handle()->height, stride, WTools::toImageFormat(format));
+    // Deep copy before the end of the access
+    const QImage copy = image.copy();
+    wlr_buffer_end_data_ptr_access(d->cursorBuffer->handle());
+
+    return copy;
+}
+
+WAYLIB_SERVER_END_NAMESPACE
+
+#include "moc_woutputframeexporter.cpp"
@@ -0,0 +1,68 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+#include <qwglobal.h>
+
+#include <QObject>
+#include <QRegion>
+#include <QImage>
+
+QW_BEGIN_NAMESPACE
+class qw_buffer;
+QW_END_NAMESPACE
+
+struct wlr_dmabuf_attributes;
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WOutputViewport;
+class WOutputFrameExporterPrivate;
+class WAYLIB_SERVER_EXPORT WOutputFrameExporter : public QObject, public WObject
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WOutputFrameExporter)
+    Q_PROPERTY(bool cursorAsMetadata READ cursorAsMetadata WRITE setCursorAsMetadata NOTIFY cursorAsMetadataChanged FINAL)
+
+public:
+    explicit WOutputFrameExporter(WOutputViewport *viewport, QObject *parent = nullptr);
+    ~WOutputFrameExporter();
+
+    WOutputViewport *viewport() const;
+
+    // Report the cursor by the cursor* functions, it's out of the frames while it's on
+    // a hardware plane, or the output has no local viewer(headless or offscreen).
+    // A cursor composited by software stays in the frames, hasCursor is false.
+    bool cursorAsMetadata() const;
+    void setCursorAsMetadata(bool on);
+
+    // The last committed frame, it's locked until the next frame or releaseFrame(),
+    // the output can't reuse it while it's locked.
+    QW_NAMESPACE::qw_buffer *buffer() const;
+    quint64 frameSequence() const;
+    // The changed region of the frames since the last call, in buffer coordinates
+    QRegion takeDamage();
+    void releaseFrame();
+
+    // Maps the buffer for reading without a copy, only one mapping at once
+    bool beginAccess(const uchar **data, uint32_t *format, size_t *stride);
+    void endAccess();
+    // For the GPU encoders, the file descriptors are owned by the buffer
+    bool dmabuf(wlr_dmabuf_attributes *attribs) const;
+
+    bool hasCursor() const;
+    // The hot spot of the cursor in buffer coordinates
+    QPoint cursorPosition() const;
+    QPoint cursorHotSpot() const;
+    QW_NAMESPACE::qw_buffer *cursorBuffer() const;
+    QImage cursorImage() const;
+
+Q_SIGNALS:
+    void cursorAsMetadataChanged();
+    void frameCommitted();
+    void cursorChanged();
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -17,6 +17,12 @@
 #include <platformplugin/qwlrootsintegration.h>
 #include <platformplugin/qwlrootscreen.h>
 
+extern "C" {
+#if WLR_VERSION_MINOR >= 18
+#include <wlr/render/drm_syncobj.h>
+#endif
+}
+
 #include <QWindow>
 #include <QQuickWindow>
 #ifndef QT_NO_OPENGL
@@ -54,6 +60,11 @@ public:
         output->safeConnect(&qw_output::notify_damage, qq, [this] {
             on_damage();
         });
+        // No frame event follows the page flip that was pending at the power off
+        output->safeConnect(&WOutput::powerOnChanged, qq, [this] {
+            if (this->output->isPowerOn())
+                setRenderable(true);
+        });
         output->safeConnect(&WOutput::modeChanged, qq, [this] {
             if (renderHelper)
                 renderHelper->setSize(this->output->size());
@@ -62,6 +73,10 @@ public:
 
     ~WOutputHelperPrivate() {
         wlr_output_state_finish(&state);
+#if WLR_VERSION_MINOR >= 18
+        if (waitTimeline)
+            wlr_drm_syncobj_timeline_unref(waitTimeline);
+#endif
     }
 
     inline qw_output *qwoutput() const {
@@ -95,6 +110,10 @@ public:
     wlr_output_layer_state_array layersCache;
     QWindow *outputWindow;
     WRenderHelper *renderHelper = nullptr;
+#if WLR_VERSION_MINOR >= 18
+    wlr_drm_syncobj_timeline *waitTimeline = nullptr;
+    uint64_t waitPoint = 0;
+#endif
 
     uint renderable:1;
     uint contentIsDirty:1;
@@ -252,6 +271,64 @@ void WOutputHelper::setLayers(const wlr_output_layer_state_array &layers)
     }
 }
 
+void WOutputHelper::setTearingPageFlip(bool on)
+{
+    W_D(WOutputHelper);
+    d->state.tearing_page_flip = on;
+}
+
+bool WOutputHelper::tearingPageFlip() const
+{
+    W_DC(WOutputHelper);
+    return d->state.tearing_page_flip;
+}
+
+void WOutputHelper::setAdaptiveSync(bool enabled)
+{
+    W_D(WOutputHelper);
+    wlr_output_state_set_adaptive_sync_enabled(&d->state, enabled);
+}
+
+void WOutputHelper::resetAdaptiveSync()
+{
+    W_D(WOutputHelper);
+    d->state.committed &= (~WLR_OUTPUT_STATE_ADAPTIVE_SYNC_ENABLED);
+}
+
+bool WOutputHelper::setRenderFence(int syncFileFd)
+{
+#if WLR_VERSION_MINOR >= 18
+    W_D(WOutputHelper);
+    Q_ASSERT(syncFileFd >= 0);
+
+    // The in-fence is only meaningful for a new buffer
+    if (!(d->state.committed & WLR_OUTPUT_STATE_BUFFER))
+        return false;
+    if (!d->qwoutput()->handle()->backend->features.timeline)
+        return false;
+
+    if (!d->waitTimeline) {
+        const int drmFd = wlr_renderer_get_drm_fd(d->renderer()->handle());
+        if (drmFd < 0)
+            return false;
+        d->waitTimeline = wlr_drm_syncobj_timeline_create(drmFd);
+        if (!d->waitTimeline)
+            return false;
+    }
+
+    // Don't take the fd's ownership, it's shared by all outputs of this frame
+    if (!wlr_drm_syncobj_timeline_import_sync_file(d->waitTimeline, d->waitPoint + 1, syncFileFd))
+        return false;
+
+    ++d->waitPoint;
+    wlr_output_state_set_wait_timeline(&d->state, d->waitTimeline, d->waitPoint);
+    return true;
+#else
+    Q_UNUSED(syncFileFd);
+    return false;
+#endif
+}
+
 bool WOutputHelper::commit()
 {
     W_D(WOutputHelper);
@@ -309,10 +386,9 @@ bool WOutputHelper::needsFrame() const
 void WOutputHelper::resetState(bool resetRenderable)
 {
     W_D(WOutputHelper);
-    d->setContentIsDirty(false);
+    resetContentState();
     if (resetRenderable)
         d->setRenderable(false);
-    d->setNeedsFrame(false);
 
     // reset output state
     if (d->state.committed & WLR_OUTPUT_STATE_BUFFER) {
@@ -326,9 +402,18 @@ void WOutputHelper::resetState(bool resetRenderable)
     free(d->state.gamma_lut);
     d->state.gamma_lut = nullptr;
     pixman_region32_clear(&d->state.damage);
+    d->state.tearing_page_flip = false;
     d->state.committed = 0;
 }
 
+// Only marks the content as consumed, the pending output state is kept
+void WOutputHelper::resetContentState()
+{
+    W_D(WOutputHelper);
+    d->setContentIsDirty(false);
+    d->setNeedsFrame(false);
+}
+
 void WOutputHelper::update()
 {
     W_D(WOutputHelper);
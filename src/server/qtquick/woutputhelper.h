@@ -58,6 +58,11 @@ public:
     void setDamage(const pixman_region32 *damage);
     const pixman_region32 *damage() const;
     void setLayers(const wlr_output_layer_state_array &layers);
+    void setTearingPageFlip(bool on);
+    bool tearingPageFlip() const;
+    void setAdaptiveSync(bool enabled);
+    void resetAdaptiveSync();
+    bool setRenderFence(int syncFileFd);
     bool commit();
     bool testCommit();
     bool testCommit(QW_NAMESPACE::qw_buffer *buffer, const wlr_output_layer_state_array &layers);
@@ -67,6 +72,7 @@ public:
     bool needsFrame() const;
 
     void resetState(bool resetRenderable);
+    void resetContentState();
     void update();
 
 protected:
@@ -5,10 +5,13 @@
 #include "woutputrenderwindow.h"
 #include "wrenderhelper.h"
 #include "woutputviewport.h"
+#include "wtools.h"
 
 #include <QQuickItem>
 #include <private/qquickitem_p.h>
 
+#include <drm_fourcc.h>
+
 QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -42,6 +45,9 @@ public:
     WOutputLayer::Flags flags = {0};
     int z = 0;
     QPointF cursorHotSpot;
+    uint format = DRM_FORMAT_INVALID;
+    uint bufferFormat = DRM_FORMAT_INVALID;
+    QSize bufferSize;
     QList<WOutputViewport*> outputs;
     QList<WOutputViewport*> inOutputsByHardware;
 };
@@ -283,6 +289,57 @@ void WOutputLayer::setCursorHotSpot(QPointF newCursorHotSpot)
     Q_EMIT cursorHotSpotChanged();
 }
 
+// The DRM fourcc format of the buffer that this layer is rendered into,
+// DRM_FORMAT_INVALID (0) picks the format automatically: the 10-bit formats
+// if the source is a single surface with a 10-bit buffer, otherwise ARGB8888
+// (or XRGB8888 with the NoAlpha flag).
+//
+// A format isn't used again if the renderer can't render into it or the
+// output rejected the layer with it, the automatic format is used instead.
+// YUV formats (e.g. NV12, P010) can't be rendered by Qt Quick, they only
+// take effect when the client's buffer is given to the output directly.
+uint WOutputLayer::format() const
+{
+    W_DC(WOutputLayer);
+    return d->format;
+}
+
+void WOutputLayer::setFormat(uint newFormat)
+{
+    W_D(WOutputLayer);
+    if (d->format == newFormat)
+        return;
+    d->format = newFormat;
+    Q_EMIT formatChanged();
+}
+
+// The format of the last buffer given to the output for this layer, it's
+// the client's buffer format if the surface is scanned out directly.
+uint WOutputLayer::bufferFormat() const
+{
+    W_DC(WOutputLayer);
+    return d->bufferFormat;
+}
+
+QSize WOutputLayer::bufferSize() const
+{
+    W_DC(WOutputLayer);
+    return d->bufferSize;
+}
+
+// The memory bandwidth saved in every frame by using bufferFormat instead of
+// ARGB8888 at bufferSize, a negative value if the format uses more memory.
+qint64 WOutputLayer::savedBytesPerFrame() const
+{
+    W_DC(WOutputLayer);
+    if (d->bufferFormat == DRM_FORMAT_INVALID)
+        return 0;
+
+    const qint64 pixels = qint64(d->bufferSize.width()) * d->bufferSize.height();
+    return qRound64(pixels * (WTools::drmFormatBytesPerPixel(DRM_FORMAT_ARGB8888)
+                                - WTools::drmFormatBytesPerPixel(d->bufferFormat)));
+}
+
 void WOutputLayer::setAccepted(bool accepted)
 {
     W_D(WOutputLayer);
@@ -301,6 +358,16 @@ bool WOutputLayer::setInHardware(WOutputViewport *output, bool isHardware)
     return d->setInHardware(output, isHardware);
 }
 
+void WOutputLayer::setBuffer(uint format, const QSize &size)
+{
+    W_D(WOutputLayer);
+    if (d->bufferFormat == format && d->bufferSize == size)
+        return;
+    d->bufferFormat = format;
+    d->bufferSize = size;
+    Q_EMIT bufferFormatChanged();
+}
+
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "moc_woutputlayer.cpp"
@@ -27,6 +27,9 @@ class WAYLIB_SERVER_EXPORT WOutputLayer : public QObject
     Q_PROPERTY(QList<WOutputViewport*> inOutputsByHardware READ inOutputsByHardware NOTIFY inOutputsByHardwareChanged FINAL)
     Q_PROPERTY(int z READ z WRITE setZ NOTIFY zChanged FINAL)
     Q_PROPERTY(QPointF cursorHotSpot READ cursorHotSpot WRITE setCursorHotSpot NOTIFY cursorHotSpotChanged FINAL)
+    Q_PROPERTY(uint format READ format WRITE setFormat NOTIFY formatChanged FINAL)
+    Q_PROPERTY(uint bufferFormat READ bufferFormat NOTIFY bufferFormatChanged FINAL)
+    Q_PROPERTY(qint64 savedBytesPerFrame READ savedBytesPerFrame NOTIFY bufferFormatChanged FINAL)
     QML_NAMED_ELEMENT(OutputLayer)
     QML_UNCREATABLE("OutputLayer is only available via attached properties")
     QML_ATTACHED(WOutputLayer)
@@ -71,6 +74,13 @@ public:
     QPointF cursorHotSpot() const;
     void setCursorHotSpot(QPointF newCursorHotSpot);
 
+    uint format() const;
+    void setFormat(uint newFormat);
+
+    uint bufferFormat() const;
+    QSize bufferSize() const;
+    qint64 savedBytesPerFrame() const;
+
 Q_SIGNALS:
     void enabledChanged();
     void flagsChanged();
@@ -80,11 +90,14 @@ Q_SIGNALS:
     void keepLayerChanged();
     void forceChanged();
     void cursorHotSpotChanged();
+    void formatChanged();
+    void bufferFormatChanged();
 
 private:
     void setAccepted(bool accepted);
     bool isAccepted() const;
     bool setInHardware(WOutputViewport *output, bool isHardware);
+    void setBuffer(uint format, const QSize &size);
 
     friend class OutputLayer;
 };
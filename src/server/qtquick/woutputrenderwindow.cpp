@@ -6,12 +6,20 @@
 #include "woutputhelper.h"
 #include "wrenderhelper.h"
 #include "wbackend.h"
+#include "wserver.h"
+#include "winputlatencytracker.h"
 #include "woutputviewport.h"
 #include "woutputviewport_p.h"
 #include "wqmlhelper_p.h"
 #include "woutputlayer.h"
 #include "wbufferrenderer_p.h"
 #include "wquicktextureproxy.h"
+#include "wsurfaceitem.h"
+#include "wsurface.h"
+#include "wtoplevelsurface.h"
+#include "private/wsurface_p.h"
+#include "private/woutputframeexporter_p.h"
+#include "wtools.h"
 
 #include "platformplugin/qwlrootsintegration.h"
 #include "platformplugin/qwlrootscreen.h"
@@ -34,7 +42,15 @@
 #include <QQuickRenderControl>
 #include <QOpenGLFunctions>
 #include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QAnimationDriver>
+#include <QMetaEnum>
+#include <QTextStream>
+#include <QSocketNotifier>
 #include <memory>
+#include <unistd.h>
+#include <fcntl.h>
 
 #define protected public
 #define private public
@@ -61,7 +77,11 @@ extern "C" {
 #ifdef ENABLE_VULKAN_RENDER
 #include <wlr/render/vulkan.h>
 #endif
+#include <wlr/backend/headless.h>
 #include <wlr/render/gles2.h>
+#include <wlr/render/pass.h>
+#include <wlr/util/region.h>
+#include <wlr/util/transform.h>
 }
 
 #include <drm_fourcc.h>
@@ -73,6 +93,7 @@ Q_LOGGING_CATEGORY(wlcRenderer, "waylib.server.renderer", QtDebugMsg)
 #else
 Q_LOGGING_CATEGORY(wlcRenderer, "waylib.server.renderer", QtWarningMsg)
 #endif
+Q_LOGGING_CATEGORY(qLcRenderWakeup, "waylib.server.renderer.wakeup", QtWarningMsg)
 inline static void resetGlState()
 {
 #ifndef QT_NO_OPENGL
@@ -116,6 +137,63 @@ private:
     using WQuickTextureProxy::setSourceItem;
 };
 
+static uint32_t bufferFormatOf(wlr_buffer *buffer)
+{
+    wlr_dmabuf_attributes dmabuf;
+    if (wlr_buffer_get_dmabuf(buffer, &dmabuf))
+        return dmabuf.format;
+    wlr_shm_attributes shm;
+    if (wlr_buffer_get_shm(buffer, &shm))
+        return shm.format;
+    return DRM_FORMAT_INVALID;
+}
+
+// Returns the surface content if the layer's source shows nothing but it
+static WSurfaceItemContent *singleSurfaceContent(QQuickItem *source)
+{
+    auto content = qobject_cast<WSurfaceItemContent*>(source);
+    if (auto surfaceItem = qobject_cast<WSurfaceItem*>(source)) {
+        content = qobject_cast<WSurfaceItemContent*>(surfaceItem->contentItem());
+        for (auto child : surfaceItem->childItems()) {
+            if (child != content && child != surfaceItem->eventItem() && child->isVisible())
+                return nullptr;
+        }
+    }
+
+    if (!content || !content->live() || !content->childItems().isEmpty())
+        return nullptr;
+    if (!content->surface() || content->surface()->hasSubsurface())
+        return nullptr;
+
+    return content;
+}
+
+static uint32_t defaultLayerFormat(WOutputLayer *layer)
+{
+    return layer->flags().testFlag(WOutputLayer::NoAlpha) ? DRM_FORMAT_XRGB8888 : DRM_FORMAT_ARGB8888;
+}
+
+static bool isYuvFormat(uint32_t format)
+{
+    switch (format) {
+    case DRM_FORMAT_NV12:
+    case DRM_FORMAT_NV21:
+    case DRM_FORMAT_NV16:
+    case DRM_FORMAT_NV61:
+    case DRM_FORMAT_P010:
+    case DRM_FORMAT_P012:
+    case DRM_FORMAT_P016:
+    case DRM_FORMAT_YUV420:
+    case DRM_FORMAT_YVU420:
+    case DRM_FORMAT_YUYV:
+    case DRM_FORMAT_UYVY:
+        return true;
+    default: break;
+    }
+
+    return false;
+}
+
 class OutputLayer;
 class Q_DECL_HIDDEN OutputHelper : public WOutputHelper
 {
@@ -149,6 +227,18 @@ public:
         QRect mapToOutput;
         QSize pixelSize;
         QMatrix4x4 renderMatrix;
+        uint32_t renderFormat = DRM_FORMAT_INVALID;
+        // The format that can't be rendered or was rejected by the plane
+        uint32_t failedFormat = DRM_FORMAT_INVALID;
+        uint32_t requestedFormat = DRM_FORMAT_INVALID;
+
+        // for zero-copy, the client surface's buffer is given to the plane
+        QPointer<WSurface> directSurface;
+        QRect directDstBox;
+        // The last direct buffer rejected by the plane, don't test it again
+        QSize rejectedBufferSize;
+        QRectF rejectedSourceBox;
+        QRect rejectedDstBox;
 
         // for proxy
         LayerData *mapFromLayer = nullptr; // check mapFrom before use
@@ -170,12 +260,7 @@ public:
         qDeleteAll(m_layers);
     }
 
-    inline void init() {
-        connect(this, &OutputHelper::requestRender, renderWindow(), qOverload<>(&WOutputRenderWindow::render));
-        connect(this, &OutputHelper::damaged, renderWindow(), &WOutputRenderWindow::scheduleRender);
-        // TODO: pre update scale after WOutputHelper::setScale
-        output()->output()->safeConnect(&WOutput::scaleChanged, this, &OutputHelper::updateSceneDPR);
-    }
+    void init();
 
     inline qw_output *qwoutput() const {
         return output()->output()->handle();
@@ -220,6 +305,9 @@ public:
     void sortLayers();
     void cleanLayerCompositor();
     void cleanCursorRender();
+    void updatePowerState();
+    QList<std::pair<WBufferRenderer*, WOutputRenderWindow::BufferPurpose>> bufferRenderers() const;
+    qint64 releaseDisabledLayerRenderers(qint64 timeout, bool *hasPending = nullptr);
 
     inline qw_buffer *beginRender(WBufferRenderer *renderer,
                                  const QSize &pixelSize, uint32_t format,
@@ -233,21 +321,94 @@ public:
     }
 
     qw_buffer *renderLayer(LayerData *layer, bool *dontEndRenderAndReturnNeedsEndRender);
+    uint32_t pickLayerFormat(LayerData *layer) const;
+    bool tryDirectScanout(LayerData *layer, wlr_output_layer_state *state);
     WBufferRenderer *afterRender();
-    WBufferRenderer *compositeLayers(const QVector<LayerData*> layers, bool forceShadowRenderer);
-    bool commit(WBufferRenderer *buffer);
+    WBufferRenderer *compositeLayers(QList<LayerData*> layers, bool forceShadowRenderer);
+    bool canShareMirrorBuffer(OutputHelper *source, qw_buffer *buffer);
+    WBufferRenderer *renderMirror(OutputHelper *source, qw_buffer *sourceBuffer,
+                                  const pixman_region32_t *sourceDamage);
+    LayerData *hardwareCursorLayer() const;
+    bool cursorIsMetadata() const;
+    void exportFrame(WBufferRenderer *buffer);
+    void exportFrame(WBufferRenderer *renderer, qw_buffer *buffer, const QRegion &damage);
+    void updateMirrors();
+    inline qw_buffer *lastCommittedBuffer() const {
+        return m_lastCommitBuffer ? m_lastCommitBuffer->lastBuffer() : nullptr;
+    }
+    bool commit(WBufferRenderer *buffer, int renderFence = -1);
+    inline bool isRenderingAhead() const {
+        return m_renderingAhead;
+    }
+    inline bool hasAheadFrame() const {
+        return m_hasAheadFrame;
+    }
+    inline void setRenderingAhead(bool on) {
+        m_renderingAhead = on;
+    }
+    bool canRenderAhead() const;
+    void keepAheadFrame(WBufferRenderer *buffer, int renderFence);
+    bool commitAheadFrame();
+    void dropAheadFrame();
     bool tryToHardwareCursor(const LayerData *layer);
+    WSurface *fullscreenSurface() const;
+    inline void invalidateFullscreenSurface() {
+        m_topmostContentIsValid = false;
+    }
+    bool tearingAllowed() const;
+    void updateVrrSurface();
+    bool vrrActive() const;
+    bool vrrFrameIsReady();
 
 private:
+    void prepareCommit(WBufferRenderer *buffer, int renderFence);
+
     WOutputViewport *m_output = nullptr;
     QList<LayerData*> m_layers;
     WBufferRenderer *m_lastCommitBuffer = nullptr;
+    // for render-ahead
+    bool m_renderingAhead = false;
+    bool m_hasAheadFrame = false;
+    bool m_lastFrameDamaged = true;
+    // the frame rendered ahead, exported after it's committed
+    QPointer<WBufferRenderer> m_aheadRenderer;
+    QPointer<qw_buffer> m_aheadBuffer;
+    QRegion m_aheadDamage;
     // only for render cursor
     QPointer<WBufferRenderer> m_cursorRenderer;
     BufferRendererProxy *m_cursorLayerProxy = nullptr;
     bool m_cursorDirty = false;
     bool m_hardwareCursorRenderComplete = false;
 
+    // for adaptive sync
+    QPointer<WSurface> m_vrrSurface;
+    bool m_vrrFrameReady = false;
+    bool m_vrrRejected = false;
+    bool m_adaptiveSyncByVrr = false;
+
+    // The topmost content item of this viewport, reset by the scene changes
+    mutable QPointer<WSurfaceItemContent> m_topmostContent;
+    mutable bool m_topmostContentIsValid = false;
+    // The last async page flip test, only test again if the surface or format is changed
+    struct {
+        QPointer<WSurface> surface;
+        uint32_t format = DRM_FORMAT_INVALID;
+        bool accepted = false;
+    } m_tearingTest;
+    QElapsedTimer m_lastCommitTimer;
+    QTimer *m_vrrGuardTimer = nullptr;
+
+
+    // for mirror, the layout of the last blit
+    QPointer<qw_buffer> m_mirrorSourceBuffer;
+    QSize m_mirrorSourceSize;
+    wlr_box m_mirrorDstBox = {};
+    wl_output_transform m_mirrorTransform = WL_OUTPUT_TRANSFORM_NORMAL;
+    // the last buffer layout tested for sharing the source's buffer
+    QSize m_mirrorTestedSize;
+    uint32_t m_mirrorTestedFormat = DRM_FORMAT_INVALID;
+    bool m_mirrorShareOk = false;
+
     // for compositeLayers
     QPointer<WOutputViewport> m_output2;
     QPointer<QQuickItem> m_layerPorxyContainer;
@@ -331,6 +492,9 @@ public:
     inline bool keepLayer() const {
         return layer->keepLayer();
     }
+    inline void setBuffer(wlr_buffer *buffer) {
+        layer->setBuffer(bufferFormatOf(buffer), QSize(buffer->width, buffer->height));
+    }
 
 private:
     friend class WOutputRenderWindow;
@@ -362,6 +526,71 @@ public:
 };
 
 static QEvent::Type doRenderEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+// Ticks the animations by the frame events of the outputs instead of Qt's
+// free running 16ms timer, the animations step to the predicted presentation
+// time of the frame they're rendered in.
+class Q_DECL_HIDDEN OutputAnimationDriver : public QAnimationDriver
+{
+public:
+    explicit OutputAnimationDriver(WOutputRenderWindowPrivate *window)
+        : m_window(window)
+    {
+        m_idleTimer.setSingleShot(true);
+        m_idleTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&m_idleTimer, &QTimer::timeout, this, [this] {
+            m_idleTick = true;
+            requestFrame();
+        });
+    }
+
+    qint64 elapsed() const override {
+        return (m_frameNsecs - m_startNsecs) / 1000000;
+    }
+
+    void advanceTo(qint64 presentNsecs) {
+        m_idleTimer.stop();
+        // The outputs of different refresh rates can predict an earlier time
+        // than the last frame, the animation time never goes back.
+        m_frameNsecs = qMax(m_frameNsecs, presentNsecs);
+        advance();
+    }
+
+    // No output committed the last tick, e.g. the animated items are
+    // invisible, keep the animations going by a timer of the refresh period.
+    void tickLater(qint64 refreshNsecs) {
+        if (!isRunning() || m_idleTimer.isActive())
+            return;
+        m_idleTimer.start(qMax<qint64>(1, refreshNsecs / 1000000));
+    }
+    inline bool takeIdleTick() {
+        return std::exchange(m_idleTick, false);
+    }
+
+protected:
+    void start() override {
+        m_startNsecs = WTools::monotonicNsecs();
+        m_frameNsecs = m_startNsecs;
+        QAnimationDriver::start();
+        requestFrame();
+    }
+
+    void stop() override {
+        m_idleTimer.stop();
+        m_idleTick = false;
+        QAnimationDriver::stop();
+    }
+
+private:
+    void requestFrame();
+
+    WOutputRenderWindowPrivate *m_window;
+    QTimer m_idleTimer;
+    qint64 m_startNsecs = 0;
+    qint64 m_frameNsecs = 0;
+    bool m_idleTick = false;
+};
+
 class Q_DECL_HIDDEN WOutputRenderWindowPrivate : public QQuickWindowPrivate
 {
 public:
@@ -417,8 +646,14 @@ public:
     void updateSceneDPR();
     void sortOutputs();
 
+    QRectF updateItemSceneRect(QQuickItem *item, int *budget);
+    void routeSceneChanges();
+    void markOutputsDirty(const QList<QRectF> &dirtyRects, bool fullUpdate);
+    void advanceAnimators();
+
     QVector<std::pair<OutputHelper *, WBufferRenderer *>>
     doRenderOutputs(const QList<OutputHelper *> &outputs, bool forceRender);
+    void advanceAnimations(const QList<OutputHelper *> &outputs);
     void doRender(const QList<OutputHelper*> &outputs, bool forceRender, bool doCommit);
     inline void doRender() {
         doRender(outputs, false, true);
@@ -428,16 +663,42 @@ public:
         rendererList.push(renderer);
     }
 
-    inline void scheduleDoRender() {
+    // Handle the client requests that arrived since the last dispatch before
+    // the scene is synced, instead of leaving them behind the frame, so the
+    // buffers they commit are shown in this frame already.
+    inline void dispatchClientEvents() {
+        if (auto server = this->server())
+            server->dispatchEvents();
+    }
+
+    inline WServer *server() const {
+        if (outputs.isEmpty())
+            return nullptr;
+        auto output = outputs.first()->output()->output();
+        return output ? output->server() : nullptr;
+    }
+
+    inline void scheduleDoRender(WOutputRenderWindow::WakeupSource source = WOutputRenderWindow::UpdateRequest) {
         if (!isInitialized())
             return; // Not initialized
 
         if (inRendering)
             return;
 
+        if (!acceptWakeup(source))
+            return;
+
         QCoreApplication::postEvent(q_func(), new QEvent(doRenderEventType));
     }
 
+    bool hasPendingWork() const;
+    bool acceptWakeup(WOutputRenderWindow::WakeupSource source);
+    void onOutputFrame();
+
+    void initMemoryPressureMonitor();
+    void updateBufferMemory();
+    qint64 trimBuffers(qint64 bytes, qint64 minIdleMsecs);
+
     Q_DECLARE_PUBLIC(WOutputRenderWindow)
 
     bool componentCompleted = true;
@@ -449,6 +710,12 @@ public:
     QList<OutputHelper*> outputs;
     QList<OutputLayer*> layers;
     bool disableLayers = false;
+    // The count of the committing renders, for the renders nested in a dispatch
+    quint64 frameCount = 0;
+
+    // Bytes uploaded to the surface textures since the previous frame
+    quint64 uploadBytesAtLastFrame = 0;
+    qint64 lastFrameUploadBytes = 0;
 
     QOpenGLContext *glContext = nullptr;
 #ifdef ENABLE_VULKAN_RENDER
@@ -456,8 +723,59 @@ public:
 #endif
 
     QStack<WBufferRenderer*> rendererList;
+
+    // The scene bounds of the items' subtrees at their last change, to damage
+    // the area they're moved or removed from.
+    QHash<QQuickItem*, QRectF> lastItemSceneRects;
+    // The scene bounds of the running animators' targets at the last frame
+    QHash<QQuickItem*, QRectF> lastAnimatorRects;
+
+    OutputAnimationDriver *animationDriver = nullptr;
+
+    bool idlePowerSaving = false;
+    struct WakeupStats {
+        quint64 accepted = 0;
+        quint64 suppressed = 0;
+        // Accepted, but no output committed a frame
+        quint64 wasted = 0;
+    };
+    WakeupStats wakeupStats[WOutputRenderWindow::WakeupSourceCount];
+    // The sources that woke up the render loop since the last frame
+    uint pendingWakeups = 0;
+
+    // 0 is unlimited
+    qint64 bufferMemoryBudget = 0;
+    qint64 bufferMemoryUsage = 0;
+    int layerBufferTimeout = 10000;
+    QTimer *bufferReclaimTimer = nullptr;
+    QSocketNotifier *memoryPressureNotifier = nullptr;
 };
 
+void OutputAnimationDriver::requestFrame()
+{
+    // Only schedule a frame, the outputs are marked dirty by the changes
+    // of the animated items, see routeSceneChanges.
+    m_window->scheduleDoRender(WOutputRenderWindow::Timer);
+}
+
+void OutputHelper::init()
+{
+    connect(this, &OutputHelper::requestRender, renderWindow(), [this] {
+        renderWindowD()->onOutputFrame();
+    });
+    connect(this, &OutputHelper::damaged, renderWindow(), [this] {
+        renderWindowD()->scheduleDoRender(WOutputRenderWindow::OutputDamage);
+    });
+    // TODO: pre update scale after WOutputHelper::setScale
+    output()->output()->safeConnect(&WOutput::scaleChanged, this, &OutputHelper::updateSceneDPR);
+    output()->output()->safeConnect(&WOutput::powerOnChanged, this, &OutputHelper::updatePowerState);
+    // Re-evaluate the driving surface and the adaptive sync at the next commit
+    connect(output(), &WOutputViewport::vrrPolicyChanged, this, [this] {
+        update();
+        renderWindowD()->scheduleDoRender(WOutputRenderWindow::OutputChange);
+    });
+}
+
 WOutputRenderWindowPrivate *OutputHelper::renderWindowD() const
 {
     return WOutputRenderWindowPrivate::get(renderWindow());
@@ -570,6 +888,81 @@ void OutputHelper::cleanCursorRender()
     }
 }
 
+void OutputHelper::updatePowerState()
+{
+    if (output()->output()->isPowerOn()) {
+        // The buffers were released, repaint all on resume
+        update();
+        renderWindowD()->scheduleDoRender(WOutputRenderWindow::OutputChange);
+        return;
+    }
+
+    // Nothing is rendered for the powered off output, see doRenderOutputs,
+    // release its buffers, the layers are recreated on resume.
+    dropAheadFrame();
+    cleanLayerCompositor();
+    cleanCursorRender();
+    for (auto layer : std::as_const(m_layers)) {
+        if (layer->renderer && !layer->renderer->currentBuffer())
+            layer->renderer->releaseBuffers();
+        layer->directSurface = nullptr;
+    }
+
+    if (!bufferRenderer()->currentBuffer())
+        bufferRenderer()->releaseBuffers();
+    m_lastCommitBuffer = nullptr;
+    m_mirrorSourceBuffer = nullptr;
+    m_mirrorSourceSize = {};
+}
+
+QList<std::pair<WBufferRenderer*, WOutputRenderWindow::BufferPurpose>> OutputHelper::bufferRenderers() const
+{
+    QList<std::pair<WBufferRenderer*, WOutputRenderWindow::BufferPurpose>> list;
+    if (!m_output)
+        return list;
+
+    list.append({bufferRenderer(), m_output->offscreen() ? WOutputRenderWindow::OffscreenBuffer
+                                                         : WOutputRenderWindow::ViewportBuffer});
+    for (auto layer : std::as_const(m_layers)) {
+        if (layer->renderer)
+            list.append({layer->renderer, WOutputRenderWindow::LayerBuffer});
+    }
+    if (m_cursorRenderer)
+        list.append({m_cursorRenderer, WOutputRenderWindow::CursorBuffer});
+    if (m_output2)
+        list.append({bufferRenderer2(), WOutputRenderWindow::CompositorBuffer});
+
+    return list;
+}
+
+// Frees the renderers of the layers that aren't composited for the timeout,
+// they're recreated when the layers are enabled again.
+qint64 OutputHelper::releaseDisabledLayerRenderers(qint64 timeout, bool *hasPending)
+{
+    qint64 freed = 0;
+    for (auto layer : std::as_const(m_layers)) {
+        auto renderer = layer->renderer.data();
+        // The locked buffer is still shown, e.g. by the cursor or the compositor
+        if (!renderer || layer->layer->needsComposite() || renderer->currentBuffer()
+            || renderer->isCacheBufferLocked())
+            continue;
+
+        const qint64 idle = renderer->idleMsecs();
+        if (idle >= 0 && idle < timeout) {
+            if (hasPending)
+                *hasPending = true;
+            continue;
+        }
+
+        freed += renderer->allocatedBytes();
+        renderer->deleteLater();
+        layer->renderer = nullptr;
+        layer->contentsIsDirty = true;
+    }
+
+    return freed;
+}
+
 qw_buffer *OutputHelper::beginRender(WBufferRenderer *renderer,
                                     const QSize &pixelSize, uint32_t format,
                                     WBufferRenderer::RenderFlags flags)
@@ -729,17 +1122,30 @@ qw_buffer *OutputHelper::renderLayer(LayerData *layer, bool *dontEndRenderAndRet
     }
 
     layer->mapToOutput = QRect((layer->mapRect.topLeft() * dpr).toPoint(), layer->pixelSize);
+
+    const uint32_t renderFormat = pickLayerFormat(layer);
+    if (layer->renderFormat != renderFormat) {
+        layer->renderFormat = renderFormat;
+        layer->contentsIsDirty = true;
+    }
+
     auto buffer = layer->renderer->lastBuffer();
 
     if (!buffer || layer->contentsIsDirty) {
         layer->renderer->setSize(layer->pixelSize / dpr);
 
-        const bool alpha = !layer->layer->layer->flags().testFlag(WOutputLayer::NoAlpha);
         // Don't use OutputHelper::beginRender, because the dpr maybe is from LayerData::mapFrom
-        buffer = layer->renderer->beginRender(layer->pixelSize, dpr,
-                                              // TODO: Allows control format by WOutputLayer
-                                              alpha ? DRM_FORMAT_ARGB8888 : DRM_FORMAT_XRGB8888,
+        buffer = layer->renderer->beginRender(layer->pixelSize, dpr, layer->renderFormat,
                                               WBufferRenderer::DontConfigureSwapchain);
+        const uint32_t defaultFormat = defaultLayerFormat(layer->layer->layer);
+        if (!buffer && layer->renderFormat != defaultFormat) {
+            qCDebug(wlcRenderer) << "Can't render the layer" << source << "in the format"
+                                 << Qt::hex << layer->renderFormat << ", fallback to" << defaultFormat;
+            layer->failedFormat = layer->renderFormat;
+            layer->renderFormat = defaultFormat;
+            buffer = layer->renderer->beginRender(layer->pixelSize, dpr, layer->renderFormat,
+                                                  WBufferRenderer::DontConfigureSwapchain);
+        }
         if (buffer) {
             const QRectF sr = QRectF(layer->mapRect.topLeft() - layer->noClipMapRect.topLeft(), layer->mapRect.size());
             const QRectF tr(QPointF(0, 0), layer->mapRect.size());
@@ -765,6 +1171,132 @@ qw_buffer *OutputHelper::renderLayer(LayerData *layer, bool *dontEndRenderAndRet
     return buffer;
 }
 
+uint32_t OutputHelper::pickLayerFormat(LayerData *layer) const
+{
+    auto outputLayer = layer->layer->layer;
+    const uint32_t defaultFormat = defaultLayerFormat(outputLayer);
+    // The cursor plane only takes ARGB8888
+    if (outputLayer->flags().testFlag(WOutputLayer::Cursor))
+        return defaultFormat;
+
+    if (layer->requestedFormat != outputLayer->format()) {
+        layer->requestedFormat = outputLayer->format();
+        layer->failedFormat = DRM_FORMAT_INVALID;
+    }
+
+    uint32_t format = outputLayer->format();
+    if (format == DRM_FORMAT_INVALID) {
+        // Keep the color depth of the client's buffer
+        auto content = singleSurfaceContent(outputLayer->parent());
+        auto buffer = content ? content->surface()->buffer() : nullptr;
+        switch (buffer ? bufferFormatOf(buffer->handle()) : DRM_FORMAT_INVALID) {
+        case DRM_FORMAT_ARGB2101010:
+        case DRM_FORMAT_ABGR2101010:
+        case DRM_FORMAT_XRGB2101010:
+        case DRM_FORMAT_XBGR2101010:
+        case DRM_FORMAT_P010:
+            format = outputLayer->flags().testFlag(WOutputLayer::NoAlpha)
+                         ? DRM_FORMAT_XRGB2101010 : DRM_FORMAT_ARGB2101010;
+            break;
+        default:
+            return defaultFormat;
+        }
+    }
+
+    // Qt Quick can't render into the YUV buffers
+    if (isYuvFormat(format) || format == layer->failedFormat)
+        return defaultFormat;
+
+    return format;
+}
+
+bool OutputHelper::tryDirectScanout(LayerData *layer, wlr_output_layer_state *state)
+{
+    layer->directSurface = nullptr;
+
+    // The cursor plane and the mapped layers of other outputs need the rendered buffer
+    const auto layerFlags = layer->layer->layer->flags();
+    if (layer->mapFrom || (layerFlags & WOutputLayer::Cursor) || visualizeLayers())
+        return false;
+    if (output()->disableHardwareLayers() && !layer->layer->forceLayer())
+        return false;
+    if (qwoutput()->handle()->transform != WL_OUTPUT_TRANSFORM_NORMAL)
+        return false;
+
+    // Only a layer that shows exactly one client surface
+    auto content = singleSurfaceContent(layer->layer->layer->parent());
+    if (!content)
+        return false;
+
+    auto surface = content->surface();
+    if (!surface->buffer() || surface->orientation() != WLR::Transform::Normal
+        // The planes can't wait for the client's rendering
+        || WSurfacePrivate::get(surface)->hasAcquireTimeline()) {
+        return false;
+    }
+
+    wlr_dmabuf_attributes dmabuf;
+    if (!wlr_buffer_get_dmabuf(surface->buffer()->handle(), &dmabuf))
+        return false;
+    // An explicit format is also required for the client's buffer
+    const uint32_t format = layer->layer->layer->format();
+    if (format != DRM_FORMAT_INVALID && dmabuf.format != format)
+        return false;
+
+    qreal opacity = 1.0;
+    for (auto item = static_cast<QQuickItem*>(content); item; item = item->parentItem())
+        opacity *= item->opacity();
+    if (!qFuzzyCompare(opacity, 1.0))
+        return false;
+
+    // The planes can crop and scale the buffer, but can't rotate it
+    const QMatrix4x4 matrix = output()->mapToViewport(content) * output()->sourceRectToTargetRectTransfrom();
+    if (!qFuzzyIsNull(matrix(0, 1)) || !qFuzzyIsNull(matrix(1, 0))
+        || !qFuzzyIsNull(matrix(3, 0)) || !qFuzzyIsNull(matrix(3, 1))
+        || matrix(0, 0) <= 0 || matrix(1, 1) <= 0) {
+        return false;
+    }
+
+    const QPointF offset = content->ignoreBufferOffset() ? QPointF() : QPointF(content->bufferOffset());
+    const QRectF rect = matrix.mapRect(QRectF(offset, content->size()));
+    const qreal dpr = devicePixelRatio();
+    const QRect dstBox = QRectF(rect.topLeft() * dpr, rect.size() * dpr).toRect();
+    if (dstBox.isEmpty() || !QRect(QPoint(0, 0), output()->output()->size()).contains(dstBox))
+        return false;
+
+    const QRectF sourceBox = surface->bufferSourceBox();
+    if (layer->rejectedBufferSize == surface->bufferSize()
+        && layer->rejectedSourceBox == sourceBox
+        && layer->rejectedDstBox == dstBox) {
+        return false;
+    }
+
+    *state = {
+        .layer = layer->wlrLayer->handle(),
+        .buffer = surface->buffer()->handle(),
+        .src_box = {
+            .x = sourceBox.x(),
+            .y = sourceBox.y(),
+            .width = sourceBox.width(),
+            .height = sourceBox.height(),
+        },
+        .dst_box = {
+            .x = dstBox.x(),
+            .y = dstBox.y(),
+            .width = dstBox.width(),
+            .height = dstBox.height(),
+        },
+        // The plane maybe showed another buffer, damage the whole buffer
+        .damage = nullptr,
+    };
+    layer->directSurface = surface;
+    layer->directDstBox = dstBox;
+    // The renderer's buffer is outdated while the plane shows the client buffer
+    layer->contentsIsDirty = true;
+
+    return true;
+}
+
 struct Q_DECL_HIDDEN QScopedPointerWlArrayDeleter {
     static inline void cleanup(wl_array *pointer) {
         if (pointer)
@@ -787,6 +1319,7 @@ WBufferRenderer *OutputHelper::afterRender()
     layers.reserve(m_layers.size());
     needsCompositeLayers.reserve(m_layers.size());
     int firstCantRejectLayerIndex = m_layers.size();
+    const bool cursorAsMetadata = cursorIsMetadata();
 
     for (LayerData *i : std::as_const(m_layers)) {
         if (!i->layer->isEnabled())
@@ -796,35 +1329,56 @@ WBufferRenderer *OutputHelper::afterRender()
         if (!i->layer->needsComposite())
             continue;
 
-        bool needsEndBuffer = false;
-        auto buffer = renderLayer(i, &needsEndBuffer);
-        if (!buffer)
-            continue;
+        wlr_output_layer_state state;
+        // Give the client's buffer to the plane instead of copying it,
+        // the cursor reported as the metadata is rendered to its own buffer.
+        const bool isMetadata = cursorAsMetadata && (i->layer->layer->flags() & WOutputLayer::Cursor);
+        if (isMetadata || !tryDirectScanout(i, &state)) {
+            bool needsEndBuffer = false;
+            auto buffer = renderLayer(i, &needsEndBuffer);
+            if (!buffer)
+                continue;
 
-        layers.append({
-            .layer = i->wlrLayer->handle(),
-            .buffer = buffer->handle(),
-            .dst_box = {
-                .x = i->mapToOutput.x(),
-                .y = i->mapToOutput.y(),
-                .width = i->mapToOutput.width(),
-                .height = i->mapToOutput.height(),
-            },
-            .damage = &i->renderer->damageRing()->handle()->current
-        });
+            state = {
+                .layer = i->wlrLayer->handle(),
+                .buffer = buffer->handle(),
+                .dst_box = {
+                    .x = i->mapToOutput.x(),
+                    .y = i->mapToOutput.y(),
+                    .width = i->mapToOutput.width(),
+                    .height = i->mapToOutput.height(),
+                },
+                .damage = &i->renderer->damageRing()->handle()->current
+            };
+
+            if (needsEndBuffer) {
+                // after get damage(&i->renderer->damageRing()->handle()->current)
+                i->renderer->endRender();
+            }
 
-        if (needsEndBuffer) {
-            // after get damage(&i->renderer->damageRing()->handle()->current)
-            i->renderer->endRender();
+            Q_ASSERT(!i->renderer->currentBuffer());
         }
 
-        Q_ASSERT(!i->renderer->currentBuffer());
+        layers.append(state);
         needsCompositeLayers.append(i);
 
         if (firstCantRejectLayerIndex == m_layers.size() && !i->layer->tryReject())
             firstCantRejectLayerIndex = needsCompositeLayers.size() - 1;
     }
 
+    // Nobody looks at this output, leave the cursor out of the frame, the
+    // frame exporters take it as the metadata like a cursor on a plane.
+    if (cursorAsMetadata && !layers.isEmpty()) {
+        auto topLayer = needsCompositeLayers.last();
+        if ((topLayer->layer->layer->flags() & WOutputLayer::Cursor)
+            && topLayer->layer->accept(output(), true)) {
+            needsCompositeLayers.removeLast();
+            layers.removeLast();
+            if (firstCantRejectLayerIndex >= needsCompositeLayers.size())
+                firstCantRejectLayerIndex = m_layers.size();
+        }
+    }
+
     if (layers.isEmpty()) {
         cleanLayerCompositor();
         cleanCursorRender();
@@ -840,6 +1394,68 @@ WBufferRenderer *OutputHelper::afterRender()
     }
 
     const bool ok = WOutputHelper::testCommit(bufferRenderer()->currentBuffer(), layers);
+
+    // The layers below a rejected layer are composited by software, so a client
+    // buffer is only kept if all layers above it are accepted.
+    int topRejectedLayerIndex = -1;
+    for (int i = layers.size() - 1; i >= 0; --i) {
+        if (!ok || !layers.at(i).accepted) {
+            topRejectedLayerIndex = i;
+            break;
+        }
+    }
+
+    // Fallback to render the rejected client buffers like the other layers,
+    // and the layers rejected with a non-default format in the default format
+    for (int i = 0; i <= topRejectedLayerIndex; ++i) {
+        LayerData *layer = needsCompositeLayers.at(i);
+        if (layer->directSurface) {
+            layer->rejectedBufferSize = layer->directSurface->bufferSize();
+            layer->rejectedSourceBox = layer->directSurface->bufferSourceBox();
+            layer->rejectedDstBox = layer->directDstBox;
+            layer->directSurface = nullptr;
+        } else if (!(ok && layers.at(i).accepted)
+                   && layer->renderFormat != defaultLayerFormat(layer->layer->layer)) {
+            qCDebug(wlcRenderer) << "The layer" << layer->layer->layer->parent()
+                                 << "is rejected in the format" << Qt::hex << layer->renderFormat;
+            layer->failedFormat = layer->renderFormat;
+        } else {
+            continue;
+        }
+
+        auto buffer = renderLayer(layer, nullptr);
+        if (!buffer) {
+            layers.remove(i);
+            needsCompositeLayers.removeAt(i);
+            if (firstCantRejectLayerIndex > i && firstCantRejectLayerIndex < m_layers.size())
+                --firstCantRejectLayerIndex;
+            --i;
+            --topRejectedLayerIndex;
+            continue;
+        }
+
+        auto &state = layers[i];
+        state.buffer = buffer->handle();
+        state.src_box = {};
+        state.dst_box = {
+            .x = layer->mapToOutput.x(),
+            .y = layer->mapToOutput.y(),
+            .width = layer->mapToOutput.width(),
+            .height = layer->mapToOutput.height(),
+        };
+        state.damage = nullptr;
+        state.accepted = false;
+    }
+
+    if (layers.isEmpty()) {
+        cleanLayerCompositor();
+        cleanCursorRender();
+        if (m_hardwareCursorRenderComplete) {
+            tryToHardwareCursor(nullptr);
+        }
+        return bufferRenderer();
+    }
+
     int needsSoftwareCompositeBeginIndex = -1;
     int needsSoftwareCompositeEndIndex = -1;
     bool forceShadowRender = false;
@@ -868,6 +1484,7 @@ WBufferRenderer *OutputHelper::afterRender()
         const auto &state = layers.at(i);
         Q_ASSERT(state.buffer);
         OutputLayer *layer = needsCompositeLayers[i]->layer;
+        layer->setBuffer(state.buffer);
 
         // If hardware layers is disabled on this output viewport
         // and this layer doesn't want force layer, should fallback
@@ -940,13 +1557,67 @@ WBufferRenderer *OutputHelper::afterRender()
 }
 
 #define PRIVATE_WOutputViewport "__private_WOutputViewport"
-WBufferRenderer *OutputHelper::compositeLayers(const QList<LayerData*> layers, bool forceShadowRenderer)
+// Returns true if the item a is painted before the item b in the scene
+static bool paintsBefore(QQuickItem *a, QQuickItem *b)
+{
+    QList<QQuickItem*> ancestorsOfA;
+    for (auto item = a; item; item = item->parentItem())
+        ancestorsOfA.prepend(item);
+    QList<QQuickItem*> ancestorsOfB;
+    for (auto item = b; item; item = item->parentItem())
+        ancestorsOfB.prepend(item);
+
+    int i = 0;
+    while (i < ancestorsOfA.size() && i < ancestorsOfB.size()
+           && ancestorsOfA.at(i) == ancestorsOfB.at(i)) {
+        ++i;
+    }
+
+    // The parent is painted before its children
+    if (i == ancestorsOfA.size() || i == ancestorsOfB.size())
+        return ancestorsOfA.size() < ancestorsOfB.size();
+    // Not in the same tree
+    if (i == 0)
+        return false;
+
+    const auto children = QQuickItemPrivate::get(ancestorsOfA.at(i - 1))->paintOrderChildItems();
+    return children.indexOf(ancestorsOfA.at(i)) < children.indexOf(ancestorsOfB.at(i));
+}
+
+WBufferRenderer *OutputHelper::compositeLayers(QList<LayerData*> layers, bool forceShadowRenderer)
 {
     Q_ASSERT(!layers.isEmpty());
 
-    const bool usingShadowRenderer = forceShadowRenderer
-                                     // TODO: Support preserveColorContents in Qt in QSGSoftwareRenderer
-                                     || dynamic_cast<QSGSoftwareRenderer*>(renderWindowD()->renderer);
+    // The layers of the same z are painted in the order of their items in the scene
+    std::stable_sort(layers.begin(), layers.end(), [] (const LayerData *l1, const LayerData *l2) {
+        auto layer1 = l1->layer->layer;
+        auto layer2 = l2->layer->layer;
+        if (layer1->z() != layer2->z())
+            return layer1->z() < layer2->z();
+        return paintsBefore(layer1->parent(), layer2->parent());
+    });
+
+    // TODO: Support preserveColorContents in Qt in QSGSoftwareRenderer
+    const bool isSoftwareRenderer = dynamic_cast<QSGSoftwareRenderer*>(renderWindowD()->renderer);
+    if (isSoftwareRenderer && !forceShadowRenderer && bufferRenderer()->currentBuffer()) {
+        // Paint the layers' buffers into the primary buffer, only fallback
+        // to the shadow buffer if their formats can't be painted.
+        QList<std::pair<qw_buffer*, QRect>> buffers;
+        buffers.reserve(layers.size());
+        for (const auto layer : std::as_const(layers)) {
+            if (auto buffer = layer->renderer->lastBuffer())
+                buffers.append({buffer, layer->mapToOutput});
+        }
+
+        if (bufferRenderer()->paintBuffers(buffers)) {
+            cleanLayerCompositor();
+            return bufferRenderer();
+        }
+    }
+
+    // The primary buffer is kept without the forced layers, they're composited
+    // in the shadow buffer.
+    const bool usingShadowRenderer = forceShadowRenderer || isSoftwareRenderer;
 
     if (!m_layerPorxyContainer) {
         m_layerPorxyContainer = new QQuickItem(renderWindow()->contentItem());
@@ -1002,7 +1673,7 @@ WBufferRenderer *OutputHelper::compositeLayers(const QList<LayerData*> layers, b
         proxy->setRenderer(layer->renderer);
         proxy->setPosition(layer->mapRect.topLeft());
         proxy->setSize(layer->mapRect.size());
-        proxy->setZ(layer->layer->layer->z());
+        proxy->setZ(i);
     }
 
     // Clean
@@ -1042,7 +1713,207 @@ WBufferRenderer *OutputHelper::compositeLayers(const QList<LayerData*> layers, b
     return bufferRenderer();
 }
 
-bool OutputHelper::commit(WBufferRenderer *buffer)
+bool OutputHelper::canShareMirrorBuffer(OutputHelper *source, qw_buffer *buffer)
+{
+    // The layers of the mirror are composited into its own buffer
+    if (!m_layers.isEmpty() || isRenderingAhead() || source->isRenderingAhead())
+        return false;
+
+    auto handle = qwoutput()->handle();
+    if (handle->transform != source->qwoutput()->handle()->transform)
+        return false;
+
+    const QSize size(buffer->handle()->width, buffer->handle()->height);
+    if (size != QSize(handle->width, handle->height))
+        return false;
+
+    const uint32_t format = bufferFormatOf(buffer->handle());
+    if (size != m_mirrorTestedSize || format != m_mirrorTestedFormat) {
+        // e.g. the outputs are on different GPUs
+        m_mirrorTestedSize = size;
+        m_mirrorTestedFormat = format;
+        m_mirrorShareOk = WOutputHelper::testCommit(buffer, {});
+    }
+
+    // The own buffers of the mirror are outdated, the next blit is a full blit
+    if (m_mirrorShareOk)
+        m_mirrorSourceSize = QSize();
+
+    return m_mirrorShareOk;
+}
+
+WBufferRenderer *OutputHelper::renderMirror(OutputHelper *source, qw_buffer *sourceBuffer,
+                                            const pixman_region32_t *sourceDamage)
+{
+    auto renderer = bufferRenderer();
+    auto buffer = beginRender(renderer, output()->output()->size(), qwoutput()->handle()->render_format,
+                              WBufferRenderer::RedirectOpenGLContextDefaultFrameBufferObject);
+    if (!buffer)
+        return nullptr;
+
+    auto handle = qwoutput()->handle();
+    const auto sourceTransform = source->qwoutput()->handle()->transform;
+    // The source buffer is already transformed for the source output
+    const auto transform = wlr_output_transform_compose(wlr_output_transform_invert(sourceTransform),
+                                                        handle->transform);
+    const QSize sourceBufferSize(sourceBuffer->handle()->width, sourceBuffer->handle()->height);
+    const QSize sourceSize = sourceTransform % 2 ? sourceBufferSize.transposed() : sourceBufferSize;
+
+    int width, height;
+    wlr_output_transformed_resolution(handle, &width, &height);
+    // Keep the aspect ratio, and letterbox the rest of the output
+    const QSize fitSize = sourceSize.scaled(width, height, Qt::KeepAspectRatio);
+    const wlr_box logicalDstBox {
+        .x = (width - fitSize.width()) / 2,
+        .y = (height - fitSize.height()) / 2,
+        .width = fitSize.width(),
+        .height = fitSize.height(),
+    };
+    wlr_box dstBox;
+    wlr_box_transform(&dstBox, &logicalDstBox, wlr_output_transform_invert(handle->transform),
+                      width, height);
+
+    auto damageRing = renderer->damageRing();
+    if (sourceSize != m_mirrorSourceSize || transform != m_mirrorTransform
+        || !wlr_box_equal(&dstBox, &m_mirrorDstBox)) {
+        damageRing->add_whole();
+    } else if (sourceDamage) {
+        pixman_region32_t damage;
+        pixman_region32_init(&damage);
+        wlr_region_transform(&damage, sourceDamage, sourceTransform,
+                             sourceBufferSize.width(), sourceBufferSize.height());
+        wlr_region_scale_xy(&damage, &damage, qreal(fitSize.width()) / sourceSize.width(),
+                            qreal(fitSize.height()) / sourceSize.height());
+        // for the bilinear filter
+        wlr_region_expand(&damage, &damage, 1);
+        pixman_region32_translate(&damage, logicalDstBox.x, logicalDstBox.y);
+        wlr_region_transform(&damage, &damage, wlr_output_transform_invert(handle->transform),
+                             width, height);
+        damageRing->add(&damage);
+        pixman_region32_fini(&damage);
+    } else if (sourceBuffer != m_mirrorSourceBuffer) {
+        damageRing->add_whole();
+    }
+
+    m_mirrorSourceBuffer = sourceBuffer;
+    m_mirrorSourceSize = sourceSize;
+    m_mirrorTransform = transform;
+    m_mirrorDstBox = dstBox;
+
+    pixman_region32_t clip;
+    pixman_region32_init(&clip);
+    damageRing->get_buffer_damage(renderer->state.bufferAge, &clip);
+
+    bool ok = true;
+    if (pixman_region32_not_empty(&clip)) {
+        std::unique_ptr<qw_texture> texture { qw_texture::from_buffer(*output()->output()->renderer(),
+                                                                      *sourceBuffer) };
+        ok = false;
+        renderWindow()->beginExternalCommands();
+        auto pass = texture ? wlr_renderer_begin_buffer_pass(output()->output()->renderer()->handle(),
+                                                             buffer->handle(), nullptr)
+                            : nullptr;
+        if (pass) {
+            const wlr_render_rect_options letterbox {
+                .box = { .width = handle->width, .height = handle->height },
+                .color = { .r = 0, .g = 0, .b = 0, .a = 1 },
+                .clip = &clip,
+            };
+            wlr_render_pass_add_rect(pass, &letterbox);
+
+            const wlr_render_texture_options options {
+                .texture = texture->handle(),
+                .dst_box = dstBox,
+                .clip = &clip,
+                .transform = transform,
+                .filter_mode = WLR_SCALE_FILTER_BILINEAR,
+            };
+            wlr_render_pass_add_texture(pass, &options);
+            ok = wlr_render_pass_submit(pass);
+        }
+        renderWindow()->endExternalCommands();
+        resetGlState();
+    }
+    pixman_region32_fini(&clip);
+
+    if (!ok) {
+        qCWarning(wlcRenderer) << "Failed to blit the buffer of" << source->output() << "to" << output();
+        renderer->endRender();
+        return nullptr;
+    }
+
+    return afterRender();
+}
+
+// The cursor on a hardware plane isn't in the primary buffer, the frame exporters
+// take it as the metadata. A cursor composited by software is already in the frame.
+// On an output without a local viewer, the cursor is also out of the frame, see
+// cursorIsMetadata.
+OutputHelper::LayerData *OutputHelper::hardwareCursorLayer() const
+{
+    for (LayerData *i : std::as_const(m_layers)) {
+        if (!(i->layer->layer->flags() & WOutputLayer::Cursor) || !i->layer->isEnabled())
+            continue;
+        if (i->directSurface || !i->renderer || !i->renderer->lastBuffer())
+            continue;
+        if (i->layer->layer->inOutputsByHardware().contains(output()))
+            return i;
+    }
+
+    return nullptr;
+}
+
+// The outputs without a local viewer, e.g. the headless outputs of a remote desktop,
+// and the offscreen viewports are only seen by the frame exporters.
+bool OutputHelper::cursorIsMetadata() const
+{
+    if (!output()->offscreen() && !wlr_output_is_headless(qwoutput()->handle()))
+        return false;
+
+    for (auto exporter : std::as_const(WOutputViewportPrivate::get(output())->frameExporters)) {
+        if (exporter->cursorAsMetadata())
+            return true;
+    }
+
+    return false;
+}
+
+void OutputHelper::exportFrame(WBufferRenderer *buffer)
+{
+    if (WOutputViewportPrivate::get(output())->frameExporters.isEmpty())
+        return;
+
+    exportFrame(buffer, buffer->currentBuffer(),
+                WTools::fromPixmanRegion(&buffer->damageRing()->handle()->current));
+}
+
+void OutputHelper::exportFrame(WBufferRenderer *renderer, qw_buffer *buffer, const QRegion &damage)
+{
+    const auto exporters = WOutputViewportPrivate::get(output())->frameExporters;
+    if (exporters.isEmpty())
+        return;
+
+    for (auto exporter : exporters) {
+        auto d = WOutputFrameExporterPrivate::get(exporter);
+        if (renderer && buffer && !damage.isEmpty())
+            d->onFrameCommitted(renderer, buffer, damage);
+
+        if (!exporter->cursorAsMetadata())
+            continue;
+
+        qw_buffer *cursorBuffer = nullptr;
+        QPoint position, hotSpot;
+        if (auto layer = hardwareCursorLayer()) {
+            cursorBuffer = layer->renderer->lastBuffer();
+            hotSpot = layer->renderMatrix.map(layer->layer->layer->cursorHotSpot()
+                                              * devicePixelRatio()).toPoint();
+            position = layer->mapToOutput.topLeft() + hotSpot;
+        }
+        d->onCursorUpdated(cursorBuffer, position, hotSpot);
+    }
+}
+
+bool OutputHelper::commit(WBufferRenderer *buffer, int renderFence)
 {
     if (output()->offscreen())
         return true;
@@ -1052,24 +1923,312 @@ bool OutputHelper::commit(WBufferRenderer *buffer)
         return WOutputHelper::commit();
     }
 
+    prepareCommit(buffer, renderFence);
+    const bool ok = WOutputHelper::commit();
+    // The output state may be changed, e.g. the mode
+    if (!ok)
+        m_tearingTest = {};
+    return ok;
+}
+
+void OutputHelper::prepareCommit(WBufferRenderer *buffer, int renderFence)
+{
     setBuffer(buffer->currentBuffer());
 
+    // Only the hardware layers (e.g. the cursor) are changed if it's empty
+    m_lastFrameDamaged = pixman_region32_not_empty(&buffer->damageRing()->handle()->current);
     if (m_lastCommitBuffer == buffer) {
-        if (pixman_region32_not_empty(&buffer->damageRing()->handle()->current))
+        if (m_lastFrameDamaged)
             setDamage(&buffer->damageRing()->handle()->current);
     }
 
     m_lastCommitBuffer = buffer;
 
-    return WOutputHelper::commit();
+    // Explicit in-fence, the KMS will wait the rendering is finished on GPU
+    if (renderFence >= 0 && !setRenderFence(renderFence))
+        qCDebug(wlcRenderer) << "Can't use the explicit in-fence on" << output();
+
+    const bool wantsAdaptiveSync = output()->vrrPolicy() != WOutputViewport::NoVrr
+                                   && m_vrrSurface && !m_vrrRejected;
+    if (wantsAdaptiveSync && !output()->output()->adaptiveSyncEnabled()) {
+        setAdaptiveSync(true);
+        if (WOutputHelper::testCommit()) {
+            m_adaptiveSyncByVrr = true;
+        } else {
+            qCDebug(wlcRenderer) << "Adaptive sync is rejected on" << output();
+            // Don't try again until the driving surface is changed
+            m_vrrRejected = true;
+            resetAdaptiveSync();
+        }
+    } else if (!wantsAdaptiveSync && m_adaptiveSyncByVrr) {
+        // Only turn off the adaptive sync enabled by here, also when the policy is changed to NoVrr
+        m_adaptiveSyncByVrr = false;
+        if (output()->output()->adaptiveSyncEnabled())
+            setAdaptiveSync(false);
+    }
+
+    m_vrrFrameReady = false;
+    m_lastCommitTimer.start();
+
+    if (tearingAllowed()) {
+        WSurface *surface = fullscreenSurface();
+        const uint32_t format = bufferFormatOf(buffer->currentBuffer()->handle());
+        if (m_tearingTest.surface != surface || m_tearingTest.format != format) {
+            setTearingPageFlip(true);
+            m_tearingTest.surface = surface;
+            m_tearingTest.format = format;
+            m_tearingTest.accepted = WOutputHelper::testCommit();
+            if (!m_tearingTest.accepted) {
+                qCDebug(wlcRenderer) << "Async page flip is rejected on" << output() << ", fallback to vsync";
+                setTearingPageFlip(false);
+            }
+        } else if (m_tearingTest.accepted) {
+            setTearingPageFlip(true);
+        }
+    }
 }
 
-bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
+bool OutputHelper::canRenderAhead() const
 {
-    do {
-        auto set_cursor = qwoutput()->handle()->impl->set_cursor;
-        auto buffer = layer && layer->renderer->lastBuffer()
-                          ? layer->renderer->lastBuffer()->handle()
+    if (m_hasAheadFrame || !contentIsDirty())
+        return false;
+    if (output()->swapchainDepth() <= 2 || output()->offscreen())
+        return false;
+    // Not waiting for a page flip, e.g. the output is not committed yet
+    if (!qwoutput()->handle()->frame_pending)
+        return false;
+
+    // Demote to double buffering when the latency matters more than the
+    // throughput: the present is driven by a client, or the last frame
+    // only moved the hardware layers(e.g. the cursor).
+    if (vrrActive() || tearingAllowed() || !m_lastFrameDamaged)
+        return false;
+
+    return bufferRenderer()->acquiredBufferCount() < output()->swapchainDepth();
+}
+
+void OutputHelper::keepAheadFrame(WBufferRenderer *buffer, int renderFence)
+{
+    Q_ASSERT(m_renderingAhead);
+    m_renderingAhead = false;
+
+    if (buffer && buffer->currentBuffer()) {
+        // The output state keeps the buffer until commitAheadFrame
+        prepareCommit(buffer, renderFence);
+        m_hasAheadFrame = true;
+        // The buffer renderer ends the render before the frame is committed
+        m_aheadRenderer = buffer;
+        m_aheadBuffer = buffer->currentBuffer();
+        m_aheadDamage = WTools::fromPixmanRegion(&buffer->damageRing()->handle()->current);
+    }
+
+    resetContentState();
+}
+
+bool OutputHelper::commitAheadFrame()
+{
+    if (!m_hasAheadFrame)
+        return false;
+
+    if (!output()->output()->isEnabled()) {
+        dropAheadFrame();
+        return false;
+    }
+
+    // Wait the pending page flip
+    if (!renderable())
+        return false;
+
+    m_hasAheadFrame = false;
+    // The contents changed after the frame is rendered ahead
+    const bool dirty = contentIsDirty();
+    bool ok = WOutputHelper::commit();
+    if (ok) {
+        exportFrame(m_aheadRenderer, m_aheadBuffer, m_aheadDamage);
+        updateMirrors();
+    }
+    m_aheadRenderer = nullptr;
+    m_aheadBuffer = nullptr;
+    m_aheadDamage = QRegion();
+    resetState(ok);
+    if (dirty || !ok)
+        update();
+
+    return ok;
+}
+
+void OutputHelper::dropAheadFrame()
+{
+    if (!m_hasAheadFrame)
+        return;
+
+    m_hasAheadFrame = false;
+    m_aheadRenderer = nullptr;
+    m_aheadBuffer = nullptr;
+    m_aheadDamage = QRegion();
+    resetState(false);
+    update();
+}
+
+// The mirrors take the last committed buffer of this output
+void OutputHelper::updateMirrors()
+{
+    for (OutputHelper *helper : std::as_const(renderWindowD()->outputs)) {
+        if (helper->output()->mirrorSource() == output())
+            helper->update();
+    }
+}
+
+// Find the top most item that will be painted to the viewport
+static QQuickItem *topmostContentItem(QQuickItem *item, const WOutputViewport *viewport,
+                                      const QRectF &viewportRect)
+{
+    if (!item->isVisible() || qFuzzyIsNull(item->opacity()))
+        return nullptr;
+    // The other viewports are not rendered to this viewport directly
+    if (qobject_cast<WOutputViewport*>(item))
+        return nullptr;
+
+    auto d = QQuickItemPrivate::get(item);
+    // Hide by WOutputLayer, it's rendered in other buffer
+    if (d->extra.isAllocated() && d->extra->hideRefCount > 0)
+        return nullptr;
+
+    auto isContent = [&] (QQuickItem *i) {
+        if (!i->flags().testFlag(QQuickItem::ItemHasContents))
+            return false;
+        return viewport->mapToOutput(i, i->boundingRect()).intersects(viewportRect);
+    };
+
+    const auto children = d->paintOrderChildItems();
+    bool selfIsChecked = false;
+    for (auto child = children.crbegin(); child != children.crend(); ++child) {
+        // The item self is painted after the children with negative z
+        if (!selfIsChecked && (*child)->z() < 0) {
+            selfIsChecked = true;
+            if (isContent(item))
+                return item;
+        }
+
+        if (auto i = topmostContentItem(*child, viewport, viewportRect))
+            return i;
+    }
+
+    if (!selfIsChecked && isContent(item))
+        return item;
+
+    return nullptr;
+}
+
+WSurface *OutputHelper::fullscreenSurface() const
+{
+    const QRectF viewportRect(QPointF(0, 0), output()->size());
+    if (!m_topmostContentIsValid) {
+        auto root = output()->input() ? output()->input() : renderWindow()->contentItem();
+        m_topmostContent = qobject_cast<WSurfaceItemContent*>(topmostContentItem(root, output(), viewportRect));
+        m_topmostContentIsValid = true;
+    }
+
+    auto content = m_topmostContent.data();
+    if (!content || !content->surface())
+        return nullptr;
+
+    // Must be the only content on this viewport
+    if (!output()->mapToOutput(content, content->boundingRect()).contains(viewportRect))
+        return nullptr;
+
+    for (auto parent = content->parentItem(); parent; parent = parent->parentItem()) {
+        auto surfaceItem = qobject_cast<WSurfaceItem*>(parent);
+        if (surfaceItem && surfaceItem->shellSurface()) {
+            return surfaceItem->shellSurface()->isFullScreen()
+                       ? content->surface()
+                       : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+bool OutputHelper::tearingAllowed() const
+{
+    if (output()->tearingPolicy() == WOutputViewport::NoTearing)
+        return false;
+    // The software composite layers are the other contents
+    if (!m_layerProxys.isEmpty())
+        return false;
+
+    auto surface = fullscreenSurface();
+    return surface && surface->tearingAllowed();
+}
+
+void OutputHelper::updateVrrSurface()
+{
+    WSurface *surface = nullptr;
+    if (output()->vrrPolicy() == WOutputViewport::VrrForFullscreen
+        && m_layerProxys.isEmpty()) {
+        surface = fullscreenSurface();
+    }
+
+    if (m_vrrSurface == surface)
+        return;
+
+    if (m_vrrSurface)
+        m_vrrSurface->safeDisconnect(this);
+    m_vrrSurface = surface;
+    m_vrrFrameReady = false;
+    m_vrrRejected = false;
+
+    if (surface) {
+        // The surface is driving the contents of this output, render
+        // and commit at once after the client commits a new buffer.
+        surface->safeConnect(&qw_surface::notify_commit, this, [this] {
+            m_vrrFrameReady = true;
+            update();
+            renderWindowD()->scheduleDoRender(WOutputRenderWindow::ClientCommit);
+        });
+    }
+}
+
+bool OutputHelper::vrrActive() const
+{
+    return m_vrrSurface && output()->output()->adaptiveSyncEnabled();
+}
+
+bool OutputHelper::vrrFrameIsReady()
+{
+    if (m_vrrFrameReady)
+        return true;
+
+    // Minimum refresh guard, the other contents(e.g. the cursor) can't
+    // wait the driving client forever, flush them at the minimum refresh rate.
+    const qint64 interval = 1000 / qMax(1, output()->minimumRefreshRate());
+    const qint64 remaining = m_lastCommitTimer.isValid()
+                                 ? interval - m_lastCommitTimer.elapsed()
+                                 : 0;
+    if (remaining <= 0)
+        return true;
+
+    if (!m_vrrGuardTimer) {
+        m_vrrGuardTimer = new QTimer(this);
+        m_vrrGuardTimer->setSingleShot(true);
+        m_vrrGuardTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_vrrGuardTimer, &QTimer::timeout, this, [this] {
+            renderWindowD()->scheduleDoRender(WOutputRenderWindow::Timer);
+        });
+    }
+
+    if (!m_vrrGuardTimer->isActive())
+        m_vrrGuardTimer->start(remaining);
+
+    return false;
+}
+
+bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
+{
+    do {
+        auto set_cursor = qwoutput()->handle()->impl->set_cursor;
+        auto buffer = layer && layer->renderer->lastBuffer()
+                          ? layer->renderer->lastBuffer()->handle()
                           : nullptr;
         if (!buffer) {
             if (!m_hardwareCursorRenderComplete)
@@ -1216,6 +2375,15 @@ void WOutputRenderWindowPrivate::init()
     q->create();
     rc()->m_renderWindow = q;
 
+    animationDriver = new OutputAnimationDriver(this);
+    animationDriver->setParent(q);
+    animationDriver->install();
+
+    initMemoryPressureMonitor();
+
+    // Otherwise the surfaces wait the acquire fences in the event loop
+    WSurfacePrivate::gpuWaitsAcquireFence = WRenderHelper::canWaitSyncFile(m_renderer);
+
     for (auto output : std::as_const(outputs))
         init(output);
     updateSceneDPR();
@@ -1239,10 +2407,12 @@ void WOutputRenderWindowPrivate::init()
     QObject::connect(rc(), &QQuickRenderControl::renderRequested,
                      q, qOverload<>(&WOutputRenderWindow::update));
     QObject::connect(rc(), &QQuickRenderControl::sceneChanged,
-                     q, [q, this] {
+                     q, [this] {
         if (inRendering)
             return;
-        q->update();
+        // Only the outputs showing the dirty items are marked dirty
+        // before the scene is synced, see routeSceneChanges.
+        scheduleDoRender(WOutputRenderWindow::SceneChange);
     });
 
     Q_EMIT q->initialized();
@@ -1251,7 +2421,9 @@ void WOutputRenderWindowPrivate::init()
 void WOutputRenderWindowPrivate::init(OutputHelper *helper)
 {
     W_Q(WOutputRenderWindow);
-    QMetaObject::invokeMethod(q, &WOutputRenderWindow::scheduleRender, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(q, [this] {
+        scheduleDoRender(WOutputRenderWindow::OutputChange);
+    }, Qt::QueuedConnection);
     helper->init();
     QObject::connect(helper->output(), &WOutputViewport::dependsChanged, helper, [this] {
         sortOutputs();
@@ -1366,23 +2538,169 @@ void WOutputRenderWindowPrivate::sortOutputs()
     });
 }
 
+QRectF WOutputRenderWindowPrivate::updateItemSceneRect(QQuickItem *item, int *budget)
+{
+    if (--*budget < 0)
+        return {};
+
+    auto d = QQuickItemPrivate::get(item);
+    QRectF rect;
+    if (d->effectiveVisible) {
+        if (item->flags().testFlag(QQuickItem::ItemHasContents))
+            rect = item->mapRectToScene(item->boundingRect());
+
+        for (auto child : std::as_const(d->childItems)) {
+            rect |= updateItemSceneRect(child, budget);
+            if (*budget < 0)
+                return {};
+        }
+
+        if (item->clip())
+            rect &= item->mapRectToScene(item->clipRect());
+    }
+
+    lastItemSceneRects.insert(item, rect);
+    return rect;
+}
+
+void WOutputRenderWindowPrivate::routeSceneChanges()
+{
+    // Includes the items that are dirtied by the polish of this frame
+    auto wd = QQuickWindowPrivate::get(q_func());
+    if (!wd->dirtyItemList)
+        return;
+
+    // Give up on routing if the changes cover a large part of the scene
+    static constexpr int MaxRoutedItems = 512;
+    // The changes don't move the item or its children
+    static constexpr quint32 ContentOnlyMask = QQuickItemPrivate::Content
+                                               | QQuickItemPrivate::Smooth
+                                               | QQuickItemPrivate::Antialiasing
+                                               | QQuickItemPrivate::OpacityValue;
+
+    QList<QRectF> dirtyRects;
+    bool fullUpdate = false;
+    bool budgetExceeded = false;
+    // The items are moved, hidden, stacked or reparented
+    bool layoutChanged = false;
+    int budget = MaxRoutedItems;
+
+    for (auto item = wd->dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        const quint32 dirty = QQuickItemPrivate::get(item)->dirtyAttributes;
+        if (dirty & ~QQuickItemPrivate::Content)
+            layoutChanged = true;
+        auto oldRect = lastItemSceneRects.constFind(item);
+        if (oldRect != lastItemSceneRects.constEnd()) {
+            if (!oldRect->isEmpty())
+                dirtyRects.append(*oldRect);
+        } else if (dirty & ~ContentOnlyMask) {
+            // Don't know where the item was shown, but still record where it's
+            // shown now, the next changes of a moving item can be routed.
+            fullUpdate = true;
+        }
+
+        const QRectF newRect = updateItemSceneRect(item, &budget);
+        if (budget < 0) {
+            fullUpdate = true;
+            budgetExceeded = true;
+            break;
+        }
+
+        if (!newRect.isEmpty())
+            dirtyRects.append(newRect);
+    }
+
+    // The cache is stale after a partial walk, and keeps the destroyed items
+    if (budgetExceeded || lastItemSceneRects.size() > MaxRoutedItems * 16)
+        lastItemSceneRects.clear();
+
+    if (fullUpdate || layoutChanged) {
+        for (OutputHelper *helper : std::as_const(outputs))
+            helper->invalidateFullscreenSurface();
+    }
+
+    markOutputsDirty(dirtyRects, fullUpdate);
+}
+
+void WOutputRenderWindowPrivate::markOutputsDirty(const QList<QRectF> &dirtyRects, bool fullUpdate)
+{
+    // The outputs are sorted by their depends, see sortOutputs
+    for (OutputHelper *helper : std::as_const(outputs)) {
+        if (helper->contentIsDirty())
+            continue;
+
+        auto viewport = helper->output();
+        bool dirty = fullUpdate || viewport->viewportTransform();
+
+        if (!dirty) {
+            for (auto depend : viewport->depends()) {
+                int index = indexOfOutputHelper(depend);
+                if (index >= 0 && outputs.at(index)->contentIsDirty()) {
+                    dirty = true;
+                    break;
+                }
+            }
+        }
+
+        if (!dirty && !dirtyRects.isEmpty()) {
+            const QRectF sourceRect = viewport->effectiveSourceRect();
+            const QMatrix4x4 matrix = viewport->mapToViewport(q_func()->contentItem());
+            dirty = !sourceRect.isValid();
+            for (const QRectF &rect : std::as_const(dirtyRects)) {
+                if (dirty)
+                    break;
+                dirty = matrix.mapRect(rect).intersects(sourceRect);
+            }
+        }
+
+        if (dirty)
+            helper->update();
+    }
+}
+
 QVector<std::pair<OutputHelper*, WBufferRenderer*>>
 WOutputRenderWindowPrivate::doRenderOutputs(const QList<OutputHelper*> &outputs, bool forceRender)
 {
     QVector<OutputHelper*> renderResults;
     renderResults.reserve(outputs.size());
+    QVector<OutputHelper*> mirrors;
     for (OutputHelper *helper : std::as_const(outputs)) {
+        helper->setRenderingAhead(false);
+
         if (Q_LIKELY(!forceRender)) {
-            if (!helper->renderable()
-                || Q_UNLIKELY(!WOutputViewportPrivate::get(helper->output())->renderable())
-                || !helper->output()->output()->isEnabled())
+            if (Q_UNLIKELY(!WOutputViewportPrivate::get(helper->output())->renderable())
+                || !helper->output()->output()->isEnabled()
+                || !helper->output()->output()->isPowerOn())
                 continue;
 
-            if (!helper->contentIsDirty()) {
+            // The page flip of the last frame is pending, render the next
+            // frame ahead if the swapchain depth of this output allows it.
+            if (!helper->renderable()) {
+                if (!helper->canRenderAhead())
+                    continue;
+                helper->setRenderingAhead(true);
+            }
+
+            // A mirror is also updated by its source, see below
+            if (!helper->contentIsDirty() && !helper->output()->mirrorSource()) {
                 if (helper->needsFrame())
                     renderResults.append(helper);
                 continue;
             }
+
+            helper->updateVrrSurface();
+            // The present is driven by the fullscreen client in VRR mode,
+            // the other changes are deferred to the next client's frame.
+            if (helper->vrrActive() && !helper->vrrFrameIsReady())
+                continue;
+        } else {
+            // The forced frame replaces the frame rendered ahead
+            helper->dropAheadFrame();
+        }
+
+        if (helper->output()->mirrorSource()) {
+            mirrors.append(helper);
+            continue;
         }
 
         Q_ASSERT(helper->output()->output()->scale() <= helper->output()->devicePixelRatio());
@@ -1414,27 +2732,269 @@ WOutputRenderWindowPrivate::doRenderOutputs(const QList<OutputHelper*> &outputs,
             needsCommit.append({helper, bufferRenderer});
     }
 
+    // The mirrors take the final buffer of their sources, instead of rendering the scene
+    for (auto helper : std::as_const(mirrors)) {
+        auto source = getOutputHelper(helper->output()->mirrorSource());
+        if (!source)
+            continue;
+
+        WBufferRenderer *sourceRenderer = nullptr;
+        for (const auto &i : std::as_const(needsCommit)) {
+            if (i.first == source) {
+                sourceRenderer = i.second;
+                break;
+            }
+        }
+
+        qw_buffer *sourceBuffer = sourceRenderer ? sourceRenderer->currentBuffer() : nullptr;
+        const bool sourceIsRendered = sourceBuffer;
+        if (!sourceIsRendered && !forceRender && !helper->contentIsDirty()) {
+            if (helper->needsFrame()) {
+                if (auto bufferRenderer = helper->afterRender())
+                    needsCommit.append({helper, bufferRenderer});
+            }
+            continue;
+        }
+
+        if (!sourceBuffer)
+            sourceBuffer = source->lastCommittedBuffer();
+        if (!sourceBuffer)
+            continue;
+
+        // Scan out the same buffer if the outputs are the same
+        if (sourceIsRendered && helper->canShareMirrorBuffer(source, sourceBuffer)) {
+            needsCommit.append({helper, sourceRenderer});
+            continue;
+        }
+
+        auto bufferRenderer = helper->renderMirror(source, sourceBuffer, sourceIsRendered
+                                                   ? &sourceRenderer->damageRing()->handle()->current
+                                                   : nullptr);
+        if (bufferRenderer)
+            needsCommit.append({helper, bufferRenderer});
+    }
+
     rendererList.clear();
 
     return needsCommit;
 }
 
+// The animators write the transform and opacity nodes directly, the items
+// are not dirtied, so map the bounds by the nodes instead of the items.
+static QRectF animatorSceneRect(QQuickItem *item)
+{
+    const QRectF rect = item->boundingRect() | item->childrenRect();
+    QSGNode *node = QQuickItemPrivate::get(item)->itemNode();
+    if (!node)
+        return item->mapRectToScene(rect);
+
+    QMatrix4x4 matrix;
+    for (; node; node = node->parent()) {
+        if (node->type() == QSGNode::TransformNodeType)
+            matrix = static_cast<QSGTransformNode*>(node)->matrix() * matrix;
+    }
+    return matrix.mapRect(rect);
+}
+
 // ###: QQuickAnimatorController::advance symbol not export
-static void QQuickAnimatorController_advance(QQuickAnimatorController *ac)
+void WOutputRenderWindowPrivate::advanceAnimators()
 {
-    bool running = false;
-    for (const QSharedPointer<QAbstractAnimationJob> &job : std::as_const(ac->m_animationRoots)) {
-        if (job->isRunning()) {
-            running = true;
-            break;
+    auto ac = animationController.get();
+
+    // Instead of QQuickWindow::update, only the outputs showing the animator
+    // targets are dirtied, at their old and new positions.
+    QList<QRectF> dirtyRects;
+    QHash<QQuickItem*, QRectF> animatorRects;
+    for (QQuickAnimatorJob *job : std::as_const(ac->m_runningAnimators)) {
+        job->commit();
+
+        QQuickItem *target = job->target();
+        if (!target)
+            continue;
+        const QRectF oldRect = lastAnimatorRects.take(target);
+        if (!oldRect.isEmpty())
+            dirtyRects.append(oldRect);
+        const QRectF rect = animatorSceneRect(target);
+        animatorRects[target] |= rect;
+        if (!rect.isEmpty())
+            dirtyRects.append(rect);
+    }
+
+    // The animators finished in this frame
+    for (const QRectF &rect : std::as_const(lastAnimatorRects)) {
+        if (!rect.isEmpty())
+            dirtyRects.append(rect);
+    }
+    lastAnimatorRects = std::move(animatorRects);
+
+    // The next frame of the running animators is requested by the animation
+    // driver, the animator jobs are ticked by it like the other animations.
+    if (!dirtyRects.isEmpty())
+        markOutputsDirty(dirtyRects, false);
+}
+
+void WOutputRenderWindowPrivate::advanceAnimations(const QList<OutputHelper*> &outputs)
+{
+    if (!animationDriver || !animationDriver->isRunning())
+        return;
+
+    // Step to the earliest presentation among the outputs whose frame event
+    // arrived, the other outputs take the animation state at their next frame.
+    qint64 presentNsecs = 0;
+    for (OutputHelper *helper : outputs) {
+        auto output = helper->output()->output();
+        if (!helper->renderable() || !output->isEnabled())
+            continue;
+        const qint64 nsecs = output->predictedPresentNsecs();
+        if (presentNsecs == 0 || nsecs < presentNsecs)
+            presentNsecs = nsecs;
+    }
+
+    if (presentNsecs > 0) {
+        animationDriver->takeIdleTick();
+        animationDriver->advanceTo(presentNsecs);
+    } else if (animationDriver->takeIdleTick()) {
+        animationDriver->advanceTo(WTools::monotonicNsecs());
+    }
+}
+
+// Trims the buffers on the memory pressure reported by the kernel's PSI,
+// without polling, the notifier is only activated when the stall threshold
+// is exceeded.
+void WOutputRenderWindowPrivate::initMemoryPressureMonitor()
+{
+    const int fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return; // PSI is not supported
+
+    // 150ms of stall in a 2s window, the minimum window for unprivileged users
+    static const char trigger[] = "some 150000 2000000";
+    if (write(fd, trigger, sizeof(trigger)) < 0) {
+        qCDebug(wlcRenderer) << "Can't monitor the memory pressure:" << qt_error_string();
+        close(fd);
+        return;
+    }
+
+    W_Q(WOutputRenderWindow);
+    memoryPressureNotifier = new QSocketNotifier(fd, QSocketNotifier::Exception, q);
+    QObject::connect(memoryPressureNotifier, &QSocketNotifier::activated,
+                     q, &WOutputRenderWindow::releaseBufferMemory);
+    QObject::connect(memoryPressureNotifier, &QObject::destroyed, [fd] {
+        close(fd);
+    });
+}
+
+void WOutputRenderWindowPrivate::updateBufferMemory()
+{
+    W_Q(WOutputRenderWindow);
+
+    bool hasPendingLayers = false;
+    for (OutputHelper *helper : std::as_const(outputs))
+        helper->releaseDisabledLayerRenderers(layerBufferTimeout, &hasPendingLayers);
+
+    // Check the disabled layers again when their timeout is reached,
+    // the timer isn't started if there's nothing to free.
+    if (hasPendingLayers) {
+        if (!bufferReclaimTimer) {
+            bufferReclaimTimer = new QTimer(q);
+            bufferReclaimTimer->setSingleShot(true);
+            QObject::connect(bufferReclaimTimer, &QTimer::timeout, q, [this] {
+                if (!inRendering)
+                    updateBufferMemory();
+            });
         }
+        if (!bufferReclaimTimer->isActive())
+            bufferReclaimTimer->start(layerBufferTimeout);
     }
 
-    for (QQuickAnimatorJob *job : std::as_const(ac->m_runningAnimators))
-        job->commit();
+    qint64 usage = 0;
+    for (OutputHelper *helper : std::as_const(outputs)) {
+        for (const auto &i : helper->bufferRenderers())
+            usage += i.first->allocatedBytes();
+    }
+
+    // Only the swapchains idle for a while are trimmed, trimming the ones
+    // rendering every frame would reallocate their buffers every frame.
+    if (bufferMemoryBudget > 0 && usage > bufferMemoryBudget)
+        usage -= trimBuffers(usage - bufferMemoryBudget, 1000);
+    if (bufferMemoryBudget > 0 && usage > bufferMemoryBudget)
+        qCDebug(wlcRenderer) << "The buffers use" << usage << "bytes, over the budget" << bufferMemoryBudget;
+
+    if (bufferMemoryUsage != usage) {
+        bufferMemoryUsage = usage;
+        Q_EMIT q->bufferMemoryUsageChanged();
+    }
+}
+
+// Trims the swapchains idle for at least minIdleMsecs, the longest idle
+// first, until the bytes are freed, all of them if bytes is negative.
+qint64 WOutputRenderWindowPrivate::trimBuffers(qint64 bytes, qint64 minIdleMsecs)
+{
+    QList<std::pair<WBufferRenderer*, qint64>> candidates;
+    for (OutputHelper *helper : std::as_const(outputs)) {
+        for (const auto &i : helper->bufferRenderers()) {
+            const qint64 idle = i.first->idleMsecs();
+            if (i.first->currentBuffer() || (idle >= 0 && idle < minIdleMsecs))
+                continue;
+            candidates.append({i.first, idle < 0 ? std::numeric_limits<qint64>::max() : idle});
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [] (const auto &a, const auto &b) {
+        return a.second > b.second;
+    });
+
+    qint64 freed = 0;
+    for (const auto &i : std::as_const(candidates)) {
+        if (bytes >= 0 && freed >= bytes)
+            break;
+        freed += i.first->trimBuffers();
+    }
+
+    return freed;
+}
+
+bool WOutputRenderWindowPrivate::hasPendingWork() const
+{
+    if (dirtyItemList || !itemsToPolish.isEmpty())
+        return true;
+    if (!beforeRenderingJobs.isEmpty() || !afterRenderingJobs.isEmpty())
+        return true;
+    if (animationDriver && animationDriver->isRunning())
+        return true;
+
+    for (OutputHelper *helper : std::as_const(outputs)) {
+        // Nothing is rendered for the powered off outputs
+        if (!helper->output()->output()->isPowerOn())
+            continue;
+        if (helper->contentIsDirty() || helper->needsFrame() || helper->hasAheadFrame())
+            return true;
+    }
+
+    return false;
+}
+
+bool WOutputRenderWindowPrivate::acceptWakeup(WOutputRenderWindow::WakeupSource source)
+{
+    auto &stats = wakeupStats[source];
+    // The explicit requests are always accepted, the others wake up the
+    // render loop only if a frame would be rendered.
+    if (idlePowerSaving && source != WOutputRenderWindow::UpdateRequest
+        && source != WOutputRenderWindow::OutputChange && !hasPendingWork()) {
+        ++stats.suppressed;
+        return false;
+    }
+
+    ++stats.accepted;
+    pendingWakeups |= 1u << source;
+    return true;
+}
 
-    if (running)
-        ac->m_window->update();
+void WOutputRenderWindowPrivate::onOutputFrame()
+{
+    if (inRendering || !acceptWakeup(WOutputRenderWindow::OutputFrame))
+        return;
+    doRender();
 }
 
 void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
@@ -1443,19 +3003,46 @@ void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
     Q_ASSERT(rendererList.isEmpty());
     Q_ASSERT(!inRendering);
     inRendering = true;
+    if (doCommit)
+        ++frameCount;
+
+    if (doCommit && Q_UNLIKELY(WInputLatencyTracker::isActive()))
+        WInputLatencyTracker::instance()->markFrameStarted();
 
     W_Q(WOutputRenderWindow);
+
+    if (doCommit && !forceRender) {
+        // Queue the frames rendered ahead first, their page flip
+        // doesn't need to wait for the rendering of this frame.
+        for (OutputHelper *helper : std::as_const(outputs))
+            helper->commitAheadFrame();
+    }
+
+    if (doCommit) {
+        const quint64 uploadBytes = WSurface::totalTextureUploadBytes();
+        const qint64 frameUploadBytes = uploadBytes - uploadBytesAtLastFrame;
+        uploadBytesAtLastFrame = uploadBytes;
+        if (lastFrameUploadBytes != frameUploadBytes) {
+            lastFrameUploadBytes = frameUploadBytes;
+            Q_EMIT q->lastFrameUploadBytesChanged();
+        }
+    }
+    // Like QSGRenderLoop, step the animations before polishing the items
+    if (doCommit)
+        advanceAnimations(outputs);
+
     for (OutputLayer *layer : std::as_const(layers)) {
         layer->beforeRender(q);
     }
 
     rc()->polishItems();
+    routeSceneChanges();
 
     if (QSGRendererInterface::isApiRhiBased(WRenderHelper::getGraphicsApi()))
         rc()->beginFrame();
     rc()->sync();
 
-    QQuickAnimatorController_advance(animationController.get());
+    advanceAnimators();
     Q_EMIT q->beforeRendering();
     runAndClearJobs(&beforeRenderingJobs);
 
@@ -1468,14 +3055,79 @@ void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
         rc()->endFrame();
 
     if (doCommit) {
+        int renderFence = -1;
+#if WLR_VERSION_MINOR >= 18
+        if (!needsCommit.isEmpty() && m_renderer->handle()->features.timeline)
+            renderFence = WRenderHelper::exportRenderFence(m_renderer);
+#endif
+
         for (auto i : std::as_const(needsCommit)) {
-            bool ok = i.first->commit(i.second);
+            if (i.first->isRenderingAhead()) {
+                i.first->keepAheadFrame(i.second, renderFence);
+                if (i.second->currentBuffer())
+                    i.second->endRender();
+                continue;
+            }
+
+            bool ok = i.first->commit(i.second, renderFence);
+            if (ok)
+                i.first->exportFrame(i.second);
+            i.first->resetState(ok);
+        }
+
+        // A mirror misses the frame of its source if it's not committed with its
+        // source, e.g. its page flip is pending, take the frame at its next frame.
+        for (OutputHelper *helper : std::as_const(this->outputs)) {
+            const auto source = helper->output()->mirrorSource();
+            if (!source)
+                continue;
+
+            bool sourceIsCommitted = false;
+            bool mirrorIsCommitted = false;
+            for (const auto &i : std::as_const(needsCommit)) {
+                if (i.first == helper)
+                    mirrorIsCommitted = true;
+                else if (i.first->output() == source && !i.first->hasAheadFrame())
+                    sourceIsCommitted = true;
+            }
+            if (sourceIsCommitted && !mirrorIsCommitted)
+                helper->update();
+        }
 
-            if (i.second->currentBuffer()) {
+        // After all commits, a mirror may commit the same buffer as its source
+        for (auto i : std::as_const(needsCommit)) {
+            if (i.second->currentBuffer())
                 i.second->endRender();
+        }
+
+        if (renderFence >= 0)
+            close(renderFence);
+
+        if (!needsCommit.isEmpty())
+            updateBufferMemory();
+
+        const uint wakeups = std::exchange(pendingWakeups, 0);
+        if (needsCommit.isEmpty() && wakeups) {
+            QStringList sources;
+            const QMetaEnum sourceEnum = QMetaEnum::fromType<WOutputRenderWindow::WakeupSource>();
+            for (int i = 0; i < WOutputRenderWindow::WakeupSourceCount; ++i) {
+                if (!(wakeups & (1u << i)))
+                    continue;
+                ++wakeupStats[i].wasted;
+                sources.append(QString::fromLatin1(sourceEnum.valueToKey(i)));
             }
+            qCDebug(qLcRenderWakeup) << "Wakeup by" << sources << "committed nothing";
+        }
 
-            i.first->resetState(ok);
+        // No frame event will follow, tick the animations by a timer
+        if (needsCommit.isEmpty() && animationDriver && animationDriver->isRunning()) {
+            qint64 refreshNsecs = 0;
+            for (OutputHelper *helper : std::as_const(outputs)) {
+                const qint64 nsecs = helper->output()->output()->refreshNsecs();
+                if (nsecs > 0 && (refreshNsecs == 0 || nsecs < refreshNsecs))
+                    refreshNsecs = nsecs;
+            }
+            animationDriver->tickLater(refreshNsecs > 0 ? refreshNsecs : 16666667);
         }
     }
 
@@ -1491,6 +3143,12 @@ void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
 
     inRendering = false;
     Q_EMIT q->renderEnd();
+
+    // Handle the requests that arrived during the frame and send the buffer
+    // releases of this commit right away, the clients can start their next
+    // frame while the GPU still works on this one.
+    if (doCommit && !needsCommit.isEmpty())
+        dispatchClientEvents();
 }
 
 // TODO: Support QWindow::setCursor
@@ -1565,7 +3223,7 @@ void WOutputRenderWindow::attach(WOutputViewport *output)
 
     d->updateSceneDPR();
     d->init(newOutput);
-    d->scheduleDoRender();
+    d->scheduleDoRender(OutputChange);
 
     if (!newOutput->layers().isEmpty()) {
         if (auto od = WOutputViewportPrivate::get(output)) {
@@ -1613,10 +3271,13 @@ void WOutputRenderWindow::attach(WOutputLayer *layer, WOutputViewport *output)
 
     auto outputHelper = d->getOutputHelper(output);
     if (outputHelper && outputHelper->attachLayer(wapper))
-        d->scheduleDoRender();
+        d->scheduleDoRender(OutputChange);
 
-    connect(layer, &WOutputLayer::flagsChanged, this, &WOutputRenderWindow::scheduleRender);
-    connect(layer, &WOutputLayer::zChanged, this, &WOutputRenderWindow::scheduleRender);
+    auto scheduleRender = [d] {
+        d->scheduleDoRender(OutputChange);
+    };
+    connect(layer, &WOutputLayer::flagsChanged, this, scheduleRender);
+    connect(layer, &WOutputLayer::zChanged, this, scheduleRender);
 
     if (auto od = WOutputViewportPrivate::get(output)) {
         od->notifyLayersChanged();
@@ -1665,7 +3326,7 @@ void WOutputRenderWindow::detach(WOutputLayer *layer, WOutputViewport *output)
         return;
 
     outputHelper->detachLayer(wapper);
-    d->scheduleDoRender();
+    d->scheduleDoRender(OutputChange);
 
     if (auto od = WOutputViewportPrivate::get(output)) {
         od->notifyLayersChanged();
@@ -1803,10 +3464,177 @@ void WOutputRenderWindow::setDisableLayers(bool newDisableLayers)
     if (d->disableLayers == newDisableLayers)
         return;
     d->disableLayers = newDisableLayers;
-    d->scheduleDoRender();
+    d->scheduleDoRender(OutputChange);
     Q_EMIT disableLayersChanged();
 }
 
+qint64 WOutputRenderWindow::lastFrameUploadBytes() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->lastFrameUploadBytes;
+}
+
+// In the idle power saving mode the render loop isn't woken up by the frame
+// events, damages, scene changes and timers if no output would commit a
+// frame, so an idle screen has no posted render events and no timer wakeups.
+bool WOutputRenderWindow::idlePowerSaving() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->idlePowerSaving;
+}
+
+void WOutputRenderWindow::setIdlePowerSaving(bool on)
+{
+    Q_D(WOutputRenderWindow);
+    if (d->idlePowerSaving == on)
+        return;
+    d->idlePowerSaving = on;
+    Q_EMIT idlePowerSavingChanged();
+}
+
+QString WOutputRenderWindow::wakeupReport() const
+{
+    Q_D(const WOutputRenderWindow);
+    const QMetaEnum sourceEnum = QMetaEnum::fromType<WakeupSource>();
+
+    QString text;
+    QTextStream stream(&text);
+    stream << "Render loop wakeups (accepted/suppressed/wasted):\n";
+    for (int i = 0; i < WakeupSourceCount; ++i) {
+        const auto &stats = d->wakeupStats[i];
+        stream << "  " << sourceEnum.valueToKey(i) << ": " << stats.accepted
+               << "/" << stats.suppressed << "/" << stats.wasted << "\n";
+    }
+
+    // The event loop dispatches are not gated by idlePowerSaving, they also run
+    // the idle sources and flush the clients, but they wake up the compositor too.
+    if (auto server = d->server()) {
+        const QMetaEnum dispatchEnum = QMetaEnum::fromType<WServer::DispatchSource>();
+        stream << "Wayland event loop dispatches:\n";
+        for (int i = 0; i < WServer::DispatchSourceCount; ++i) {
+            stream << "  " << dispatchEnum.valueToKey(i) << ": "
+                   << server->dispatchCount(WServer::DispatchSource(i)) << "\n";
+        }
+    }
+
+    return text;
+}
+
+void WOutputRenderWindow::resetWakeupStats()
+{
+    Q_D(WOutputRenderWindow);
+    for (auto &stats : d->wakeupStats)
+        stats = {};
+    if (auto server = d->server())
+        server->resetDispatchStats();
+}
+
+// The swapchains are trimmed to the buffers in use when the memory of all
+// WBufferRenderer's buffers exceeds the budget, 0 is unlimited.
+qint64 WOutputRenderWindow::bufferMemoryBudget() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->bufferMemoryBudget;
+}
+
+void WOutputRenderWindow::setBufferMemoryBudget(qint64 bytes)
+{
+    Q_D(WOutputRenderWindow);
+    bytes = qMax<qint64>(0, bytes);
+    if (d->bufferMemoryBudget == bytes)
+        return;
+    d->bufferMemoryBudget = bytes;
+    if (d->isInitialized() && !d->inRendering)
+        d->updateBufferMemory();
+    Q_EMIT bufferMemoryBudgetChanged();
+}
+
+qint64 WOutputRenderWindow::bufferMemoryUsage() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->bufferMemoryUsage;
+}
+
+qint64 WOutputRenderWindow::bufferMemoryUsage(WOutputViewport *output, BufferPurpose purpose) const
+{
+    Q_D(const WOutputRenderWindow);
+    auto helper = d->getOutputHelper(output);
+    if (!helper)
+        return 0;
+
+    qint64 bytes = 0;
+    for (const auto &i : helper->bufferRenderers()) {
+        if (i.second == purpose)
+            bytes += i.first->allocatedBytes();
+    }
+
+    return bytes;
+}
+
+QVariantList WOutputRenderWindow::bufferMemoryReport() const
+{
+    Q_D(const WOutputRenderWindow);
+    const QMetaEnum purposeEnum = QMetaEnum::fromType<BufferPurpose>();
+
+    QVariantList list;
+    for (OutputHelper *helper : std::as_const(d->outputs)) {
+        for (const auto &i : helper->bufferRenderers()) {
+            int buffers = 0;
+            const qint64 bytes = i.first->allocatedBytes(&buffers);
+            if (buffers == 0)
+                continue;
+
+            auto output = helper->output()->output();
+            list.append(QVariantMap {
+                {QStringLiteral("viewport"), QVariant::fromValue(helper->output())},
+                {QStringLiteral("outputName"), output ? output->name() : QString()},
+                {QStringLiteral("purpose"), QString::fromLatin1(purposeEnum.valueToKey(i.second))},
+                {QStringLiteral("bytes"), bytes},
+                {QStringLiteral("buffers"), buffers},
+                {QStringLiteral("idleMsecs"), i.first->idleMsecs()},
+            });
+        }
+    }
+
+    return list;
+}
+
+// The renderers of the disabled layers are freed after the timeout
+int WOutputRenderWindow::layerBufferTimeout() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->layerBufferTimeout;
+}
+
+void WOutputRenderWindow::setLayerBufferTimeout(int msecs)
+{
+    Q_D(WOutputRenderWindow);
+    msecs = qMax(0, msecs);
+    if (d->layerBufferTimeout == msecs)
+        return;
+    d->layerBufferTimeout = msecs;
+    Q_EMIT layerBufferTimeoutChanged();
+}
+
+// Frees the buffers not in use right away, e.g. on memory pressure
+void WOutputRenderWindow::releaseBufferMemory()
+{
+    Q_D(WOutputRenderWindow);
+    if (!d->isInitialized())
+        return;
+
+    if (d->inRendering) {
+        QMetaObject::invokeMethod(this, &WOutputRenderWindow::releaseBufferMemory, Qt::QueuedConnection);
+        return;
+    }
+
+    for (OutputHelper *helper : std::as_const(d->outputs))
+        helper->releaseDisabledLayerRenderers(0);
+    const qint64 freed = d->trimBuffers(-1, 0);
+    qCDebug(wlcRenderer) << "Released" << freed << "bytes of the idle buffers";
+    d->updateBufferMemory();
+}
+
 void WOutputRenderWindow::render()
 {
     Q_D(WOutputRenderWindow);
@@ -1887,8 +3715,12 @@ bool WOutputRenderWindow::event(QEvent *event)
     Q_D(WOutputRenderWindow);
 
     if (event->type() == doRenderEventType) {
+        const quint64 frameCount = d->frameCount;
+        d->dispatchClientEvents();
         QCoreApplication::removePostedEvents(this, doRenderEventType);
-        d_func()->doRender();
+        // A page flip event in the dispatch may render the frame already
+        if (d->frameCount == frameCount)
+            d->doRender();
         return true;
     }
 
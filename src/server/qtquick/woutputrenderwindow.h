@@ -25,10 +25,39 @@ class WAYLIB_SERVER_EXPORT WOutputRenderWindow : public QQuickWindow, public QQm
     Q_PROPERTY(qreal width READ width WRITE setWidth NOTIFY widthChanged)
     Q_PROPERTY(qreal height READ height WRITE setHeight NOTIFY heightChanged)
     Q_PROPERTY(bool disableLayers READ disableLayers WRITE setDisableLayers NOTIFY disableLayersChanged FINAL)
+    Q_PROPERTY(qint64 lastFrameUploadBytes READ lastFrameUploadBytes NOTIFY lastFrameUploadBytesChanged FINAL)
+    Q_PROPERTY(bool idlePowerSaving READ idlePowerSaving WRITE setIdlePowerSaving NOTIFY idlePowerSavingChanged FINAL)
+    Q_PROPERTY(qint64 bufferMemoryBudget READ bufferMemoryBudget WRITE setBufferMemoryBudget NOTIFY bufferMemoryBudgetChanged FINAL)
+    Q_PROPERTY(qint64 bufferMemoryUsage READ bufferMemoryUsage NOTIFY bufferMemoryUsageChanged FINAL)
+    Q_PROPERTY(int layerBufferTimeout READ layerBufferTimeout WRITE setLayerBufferTimeout NOTIFY layerBufferTimeoutChanged FINAL)
     QML_NAMED_ELEMENT(OutputRenderWindow)
     Q_INTERFACES(QQmlParserStatus)
 
 public:
+    // What woke up the render loop, see wakeupReport
+    enum WakeupSource {
+        UpdateRequest,  // update() or scheduleRender()
+        SceneChange,    // the Qt Quick scene changed
+        OutputFrame,    // the frame event of an output
+        OutputDamage,   // the backend damaged an output
+        OutputChange,   // an output or a layer was attached, detached or changed
+        ClientCommit,   // the client driving an adaptive sync output committed
+        Timer,          // the animation or the adaptive sync minimum refresh timer
+        WakeupSourceCount
+    };
+    Q_ENUM(WakeupSource)
+
+    // What the buffers of a WBufferRenderer are used for, see bufferMemoryReport
+    enum BufferPurpose {
+        ViewportBuffer,     // the primary buffer of an output
+        OffscreenBuffer,    // the buffer of an offscreen viewport
+        LayerBuffer,        // the buffer of a WOutputLayer
+        CursorBuffer,       // the hardware cursor
+        CompositorBuffer,   // the buffer composited from the rejected layers
+        BufferPurposeCount
+    };
+    Q_ENUM(BufferPurpose)
+
     explicit WOutputRenderWindow(QObject *parent = nullptr);
     ~WOutputRenderWindow();
 
@@ -60,12 +89,30 @@ public:
     bool disableLayers() const;
     void setDisableLayers(bool newDisableLayers);
 
+    qint64 lastFrameUploadBytes() const;
+
+    bool idlePowerSaving() const;
+    void setIdlePowerSaving(bool on);
+
+    Q_INVOKABLE QString wakeupReport() const;
+    Q_INVOKABLE void resetWakeupStats();
+
+    qint64 bufferMemoryBudget() const;
+    void setBufferMemoryBudget(qint64 bytes);
+    qint64 bufferMemoryUsage() const;
+    qint64 bufferMemoryUsage(WOutputViewport *output, BufferPurpose purpose) const;
+    Q_INVOKABLE QVariantList bufferMemoryReport() const;
+
+    int layerBufferTimeout() const;
+    void setLayerBufferTimeout(int msecs);
+
 public Q_SLOTS:
     void render();
     void render(WOutputViewport *output, bool doCommit);
     void scheduleRender();
     void update();
     void update(WOutputViewport *output);
+    void releaseBufferMemory();
     void setWidth(qreal arg);
     void setHeight(qreal arg);
 
@@ -75,6 +122,11 @@ Q_SIGNALS:
     void outputViewportInitialized(WAYLIB_SERVER_NAMESPACE::WOutputViewport *output);
     void initialized();
     void disableLayersChanged();
+    void lastFrameUploadBytesChanged();
+    void idlePowerSavingChanged();
+    void bufferMemoryBudgetChanged();
+    void bufferMemoryUsageChanged();
+    void layerBufferTimeoutChanged();
     void renderEnd();
 
 private:
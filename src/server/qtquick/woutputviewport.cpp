@@ -493,6 +493,91 @@ void WOutputViewport::setDepends(const QList<WOutputViewport *> &newDepends)
     Q_EMIT dependsChanged();
 }
 
+WOutputViewport::TearingPolicy WOutputViewport::tearingPolicy() const
+{
+    W_DC(WOutputViewport);
+    return d->tearingPolicy;
+}
+
+void WOutputViewport::setTearingPolicy(TearingPolicy newTearingPolicy)
+{
+    W_D(WOutputViewport);
+    if (d->tearingPolicy == newTearingPolicy)
+        return;
+    d->tearingPolicy = newTearingPolicy;
+    Q_EMIT tearingPolicyChanged();
+}
+
+WOutputViewport::VrrPolicy WOutputViewport::vrrPolicy() const
+{
+    W_DC(WOutputViewport);
+    return d->vrrPolicy;
+}
+
+void WOutputViewport::setVrrPolicy(VrrPolicy newVrrPolicy)
+{
+    W_D(WOutputViewport);
+    if (d->vrrPolicy == newVrrPolicy)
+        return;
+    d->vrrPolicy = newVrrPolicy;
+    d->update();
+    Q_EMIT vrrPolicyChanged();
+}
+
+int WOutputViewport::minimumRefreshRate() const
+{
+    W_DC(WOutputViewport);
+    return d->minimumRefreshRate;
+}
+
+void WOutputViewport::setMinimumRefreshRate(int newMinimumRefreshRate)
+{
+    W_D(WOutputViewport);
+    newMinimumRefreshRate = qMax(1, newMinimumRefreshRate);
+    if (d->minimumRefreshRate == newMinimumRefreshRate)
+        return;
+    d->minimumRefreshRate = newMinimumRefreshRate;
+    Q_EMIT minimumRefreshRateChanged();
+}
+
+int WOutputViewport::swapchainDepth() const
+{
+    W_DC(WOutputViewport);
+    return d->swapchainDepth;
+}
+
+void WOutputViewport::setSwapchainDepth(int newSwapchainDepth)
+{
+    W_D(WOutputViewport);
+    // wlr_swapchain has at most 4 slots
+    newSwapchainDepth = qBound(2, newSwapchainDepth, 4);
+    if (d->swapchainDepth == newSwapchainDepth)
+        return;
+    d->swapchainDepth = newSwapchainDepth;
+    Q_EMIT swapchainDepthChanged();
+}
+
+WOutputViewport *WOutputViewport::mirrorSource() const
+{
+    W_DC(WOutputViewport);
+    return d->mirrorSource;
+}
+
+void WOutputViewport::setMirrorSource(WOutputViewport *newMirrorSource)
+{
+    W_D(WOutputViewport);
+    if (newMirrorSource == this || (newMirrorSource && newMirrorSource->mirrorSource())) {
+        qmlWarning(this) << "OutputViewport can't mirror itself or another mirror.";
+        return;
+    }
+
+    if (d->mirrorSource == newMirrorSource)
+        return;
+    d->mirrorSource = newMirrorSource;
+    d->update();
+    Q_EMIT mirrorSourceChanged();
+}
+
 void WOutputViewport::setOutputScale(float scale)
 {
     W_D(WOutputViewport);
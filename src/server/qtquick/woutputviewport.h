@@ -35,9 +35,30 @@ class WAYLIB_SERVER_EXPORT WOutputViewport : public QQuickItem, public virtual W
     Q_PROPERTY(QList<WAYLIB_SERVER_NAMESPACE::WOutputLayer*> layers READ layers NOTIFY layersChanged FINAL)
     Q_PROPERTY(QList<WAYLIB_SERVER_NAMESPACE::WOutputLayer*> hardwareLayers READ hardwareLayers NOTIFY hardwareLayersChanged FINAL)
     Q_PROPERTY(QList<WAYLIB_SERVER_NAMESPACE::WOutputViewport*> depends READ depends WRITE setDepends NOTIFY dependsChanged FINAL)
+    Q_PROPERTY(TearingPolicy tearingPolicy READ tearingPolicy WRITE setTearingPolicy NOTIFY tearingPolicyChanged FINAL)
+    Q_PROPERTY(VrrPolicy vrrPolicy READ vrrPolicy WRITE setVrrPolicy NOTIFY vrrPolicyChanged FINAL)
+    Q_PROPERTY(int minimumRefreshRate READ minimumRefreshRate WRITE setMinimumRefreshRate NOTIFY minimumRefreshRateChanged FINAL)
+    Q_PROPERTY(int swapchainDepth READ swapchainDepth WRITE setSwapchainDepth NOTIFY swapchainDepthChanged FINAL)
+    Q_PROPERTY(WAYLIB_SERVER_NAMESPACE::WOutputViewport* mirrorSource READ mirrorSource WRITE setMirrorSource NOTIFY mirrorSourceChanged FINAL)
     QML_NAMED_ELEMENT(OutputViewport)
 
 public:
+    enum TearingPolicy {
+        NoTearing,
+        // Using async page flip if the only content of this viewport is a
+        // fullscreen surface and the surface allows tearing, see WSurface::tearingAllowed.
+        TearingForFullscreen,
+    };
+    Q_ENUM(TearingPolicy)
+
+    enum VrrPolicy {
+        NoVrr,
+        // Enable adaptive sync if the only content of this viewport is a fullscreen
+        // surface, and the frames are presented at the surface's commit cadence.
+        VrrForFullscreen,
+    };
+    Q_ENUM(VrrPolicy)
+
     explicit WOutputViewport(QQuickItem *parent = nullptr);
     ~WOutputViewport();
 
@@ -103,6 +124,21 @@ public:
     QList<WOutputViewport *> depends() const;
     void setDepends(const QList<WOutputViewport *> &newDepends);
 
+    TearingPolicy tearingPolicy() const;
+    void setTearingPolicy(TearingPolicy newTearingPolicy);
+
+    VrrPolicy vrrPolicy() const;
+    void setVrrPolicy(VrrPolicy newVrrPolicy);
+
+    int minimumRefreshRate() const;
+    void setMinimumRefreshRate(int newMinimumRefreshRate);
+
+    int swapchainDepth() const;
+    void setSwapchainDepth(int newSwapchainDepth);
+
+    WOutputViewport *mirrorSource() const;
+    void setMirrorSource(WOutputViewport *newMirrorSource);
+
 public Q_SLOTS:
     void setOutputScale(float scale);
     void rotateOutput(WOutput::Transform t);
@@ -126,6 +162,11 @@ Q_SIGNALS:
     void layersChanged();
     void hardwareLayersChanged();
     void dependsChanged();
+    void tearingPolicyChanged();
+    void vrrPolicyChanged();
+    void minimumRefreshRateChanged();
+    void swapchainDepthChanged();
+    void mirrorSourceChanged();
 
 private:
     void componentComplete() override;
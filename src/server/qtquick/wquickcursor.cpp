@@ -17,6 +17,7 @@
 #include <qwcompositor.h>
 
 #include <QSGImageNode>
+#include <rhi/qrhi.h>
 #include <private/qquickitem_p.h>
 #include <private/qsgplaintexture_p.h>
 
@@ -32,17 +33,35 @@ public:
 
     }
 
-    void setImage(const QImage &image) {
+    void setImage(const QImage &image, const QByteArray &key) {
         if (image.isNull()) {
+            pendingImage = QImage();
+            imageKey.clear();
             resetBuffer();
             return;
         }
 
+        if (imageKey == key && (buffer || !pendingImage.isNull()))
+            return;
+
+        // The buffer is created on demand, the cursor item itself is painted from
+        // the CursorAtlas, so only upload it if others are using this provider.
+        pendingImage = image;
+        imageKey = key;
+        Q_EMIT textureChanged();
+    }
+
+    void ensureBuffer() const {
+        if (pendingImage.isNull())
+            return;
+
+        auto self = const_cast<CursorTextureProvider*>(this);
+        const QImage image = std::exchange(self->pendingImage, QImage());
         // WImageBufferImpl destroy following qw_buffer
         auto buffer = qw_buffer::create(new WImageBufferImpl(image),
                                        image.width(), image.height());
-        this->buffer.reset(buffer);
-        setBuffer(this->buffer.get());
+        self->buffer.reset(buffer);
+        self->setBuffer(self->buffer.get());
     }
 
     void setProxy(WSGTextureProvider *proxy) {
@@ -65,6 +84,7 @@ public:
     }
 
     void resetBuffer() {
+        pendingImage = QImage();
         setBuffer(nullptr);
         buffer.reset();
     }
@@ -76,23 +96,239 @@ public:
     QSGTexture *texture() const override {
         if (proxy)
             return proxy->texture();
+        ensureBuffer();
         return WSGTextureProvider::texture();
     }
     qw_texture *qwTexture() const override {
         if (proxy)
             return proxy->qwTexture();
+        ensureBuffer();
         return WSGTextureProvider::qwTexture();
     }
     qw_buffer *qwBuffer() const override {
         if (proxy)
             return proxy->qwBuffer();
+        ensureBuffer();
         return WSGTextureProvider::qwBuffer();
     }
 
     std::unique_ptr<qw_buffer, qw_buffer::droper> buffer;
     QPointer<WSGTextureProvider> proxy;
+    QImage pendingImage;
+    QByteArray imageKey;
+};
+
+class Q_DECL_HIDDEN CursorAtlasTexture : public QSGTexture
+{
+public:
+    explicit CursorAtlasTexture(const QSize &size)
+        : m_size(size)
+    {
+
+    }
+
+    ~CursorAtlasTexture() override {
+        delete m_texture;
+    }
+
+    qint64 comparisonKey() const override {
+        return qint64(qintptr(this));
+    }
+    QRhiTexture *rhiTexture() const override {
+        return m_texture;
+    }
+    QSize textureSize() const override {
+        return m_size;
+    }
+    bool hasAlphaChannel() const override {
+        return true;
+    }
+    bool hasMipmaps() const override {
+        return false;
+    }
+
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override {
+        if (!m_texture) {
+            m_texture = rhi->newTexture(QRhiTexture::RGBA8, m_size);
+            if (!m_texture->create()) {
+                qWarning() << "Failed to create the cursor atlas texture, size:" << m_size;
+                return;
+            }
+
+            // Clear to transparent, avoid the linear filtering samples the garbage around the images
+            QImage clear(m_size, QImage::Format_RGBA8888_Premultiplied);
+            clear.fill(Qt::transparent);
+            resourceUpdates->uploadTexture(m_texture, clear);
+        }
+
+        if (m_pendingUploads.isEmpty())
+            return;
+
+        QVarLengthArray<QRhiTextureUploadEntry, 16> entries;
+        for (const auto &upload : std::as_const(m_pendingUploads)) {
+            QRhiTextureSubresourceUploadDescription desc(upload.second);
+            desc.setDestinationTopLeft(upload.first);
+            entries.append(QRhiTextureUploadEntry(0, 0, desc));
+        }
+        QRhiTextureUploadDescription desc;
+        desc.setEntries(entries.cbegin(), entries.cend());
+        resourceUpdates->uploadTexture(m_texture, desc);
+        m_pendingUploads.clear();
+    }
+
+    // Shelf packing, returns an empty rect if no space
+    QRect insert(const QImage &image) {
+        const QSize size = image.size() + QSize(Padding, Padding);
+        if (size.width() > m_size.width() || size.height() > m_size.height())
+            return {};
+
+        if (m_shelfX + size.width() > m_size.width()) {
+            m_shelfY += m_shelfHeight;
+            m_shelfX = 0;
+            m_shelfHeight = 0;
+        }
+        if (m_shelfY + size.height() > m_size.height())
+            return {};
+
+        const QPoint pos(m_shelfX, m_shelfY);
+        m_shelfX += size.width();
+        m_shelfHeight = qMax(m_shelfHeight, size.height());
+
+        // Copy the image, the xcursor's buffer is owned by the cursor theme
+        m_pendingUploads.append({pos, image.convertToFormat(QImage::Format_RGBA8888_Premultiplied)});
+        return QRect(pos, image.size());
+    }
+
+    void clear() {
+        m_shelfX = m_shelfY = m_shelfHeight = 0;
+        m_pendingUploads.clear();
+    }
+
+private:
+    static constexpr int Padding = 1;
+
+    QSize m_size;
+    QRhiTexture *m_texture = nullptr;
+    QList<std::pair<QPoint, QImage>> m_pendingUploads;
+    int m_shelfX = 0;
+    int m_shelfY = 0;
+    int m_shelfHeight = 0;
 };
 
+// Shared by all WQuickCursor of a WOutputRenderWindow, the cursor images are uploaded
+// only once, the animated cursors and shape changes only switch the sub rect.
+class Q_DECL_HIDDEN CursorAtlas : public QObject
+{
+    Q_OBJECT
+public:
+    static CursorAtlas *get(WOutputRenderWindow *window) {
+        if (!window->rhi())
+            return nullptr;
+
+        auto atlas = window->findChild<CursorAtlas*>(QString(), Qt::FindDirectChildrenOnly);
+        if (!atlas)
+            atlas = new CursorAtlas(window);
+        return atlas;
+    }
+
+    QSGTexture *texture() const {
+        return m_texture.get();
+    }
+
+    // Increased when the atlas is reset, the sub rects of the old generation are invalid
+    quint64 generation() const {
+        return m_generation;
+    }
+
+    QRect ensure(const QByteArray &key, const QImage &image) {
+        Q_ASSERT(!key.isEmpty());
+        if (auto rect = m_entries.value(key); !rect.isNull())
+            return rect;
+        if (m_resetPending)
+            return {};
+
+        QRect rect = m_texture->insert(image);
+        if (rect.isNull()) {
+            // The atlas is full, the other cursors' nodes may still sample the old
+            // sub rects in this frame, so drop the old images before the next sync.
+            m_resetPending = true;
+            m_window->update();
+            return rect;
+        }
+
+        m_entries.insert(key, rect);
+        return rect;
+    }
+
+    void prewarm(const QList<std::pair<QByteArray, QImage>> &images) {
+        if (m_resetPending)
+            return;
+        for (const auto &image : images) {
+            if (m_entries.contains(image.first))
+                continue;
+            auto rect = m_texture->insert(image.second);
+            if (rect.isNull())
+                break;
+            m_entries.insert(image.first, rect);
+        }
+    }
+
+private:
+    explicit CursorAtlas(WOutputRenderWindow *window)
+        : QObject(window)
+        , m_window(window)
+        , m_texture(new CursorAtlasTexture(QSize(1024, 1024)))
+    {
+        connect(window, &QQuickWindow::sceneGraphInvalidated,
+                this, &CursorAtlas::deleteLater, Qt::DirectConnection);
+        // Before the dirty items are synced, so all users re-resolve their rects in the same sync
+        connect(window, &QQuickWindow::beforeSynchronizing,
+                this, &CursorAtlas::reset, Qt::DirectConnection);
+    }
+
+    void reset() {
+        if (!m_resetPending)
+            return;
+        m_resetPending = false;
+        m_texture->clear();
+        m_entries.clear();
+        ++m_generation;
+        Q_EMIT generationChanged();
+    }
+
+Q_SIGNALS:
+    void generationChanged();
+
+private:
+    WOutputRenderWindow *m_window;
+    std::unique_ptr<CursorAtlasTexture> m_texture;
+    QHash<QByteArray, QRect> m_entries;
+    quint64 m_generation = 0;
+    bool m_resetPending = false;
+};
+
+static const QList<QCursor> &prewarmCursors()
+{
+    static const QList<QCursor> cursors {
+        Qt::ArrowCursor,
+        Qt::IBeamCursor,
+        Qt::PointingHandCursor,
+        Qt::WaitCursor,
+        Qt::BusyCursor,
+        Qt::SizeHorCursor,
+        Qt::SizeVerCursor,
+        Qt::SizeBDiagCursor,
+        Qt::SizeFDiagCursor,
+        Qt::SizeAllCursor,
+        Qt::OpenHandCursor,
+        Qt::ClosedHandCursor,
+        Qt::ForbiddenCursor,
+        WCursor::toQCursor(WGlobal::CursorShape::Default),
+    };
+
+    return cursors;
+}
+
 WQuickCursorAttached::WQuickCursorAttached(QQuickItem *parent)
     : QObject(parent)
 {
@@ -160,6 +396,10 @@ public:
     QString xcursorThemeName;
     QSize cursorSize = QSize(24, 24);
     QPoint hotSpot;
+    // The cursor theme and scale of the prewarmed cursor atlas
+    mutable QByteArray prewarmedTheme;
+    mutable QPointer<CursorAtlas> atlas;
+    mutable quint64 atlasGeneration = 0;
 };
 
 void WQuickCursorPrivate::setHotSpot(const QPoint &newHotSpot)
@@ -376,7 +616,7 @@ WSGTextureProvider *WQuickCursor::wTextureProvider() const
         if (d->cursorSurfaceItem && d->cursorSurfaceItem->surface())
             d->textureProvider->setProxy(d->cursorSurfaceItem->wTextureProvider());
         else
-            d->textureProvider->setImage(d->cursorImage->image());
+            d->textureProvider->setImage(d->cursorImage->image(), d->cursorImage->imageKey());
     }
     return d->textureProvider;
 }
@@ -567,26 +807,64 @@ QSGNode *WQuickCursor::updatePaintNode(QSGNode *node, UpdatePaintNodeData *)
     Q_ASSERT(tp);
     Q_ASSERT(QThread::currentThread() == thread());
 
+    const QImage &image = d->cursorImage->image();
     if (d->cursorSurfaceItem && d->cursorSurfaceItem->surface()) {
         tp->setProxy(d->cursorSurfaceItem->wTextureProvider());
     } else {
-        tp->setImage(d->cursorImage->image());
+        tp->setImage(image, d->cursorImage->imageKey());
     }
 
     // Ignore the tp->proxy, Don't use tp->qwBuffer()
-    if (!tp->buffer) {
+    if (image.isNull()) {
         delete node;
         return nullptr;
     }
 
-    auto texture = tp->WSGTextureProvider::texture();
+    QSGTexture *texture = nullptr;
+    QRectF sourceRect;
+    if (auto atlas = CursorAtlas::get(tp->window())) {
+        if (d->atlas != atlas) {
+            if (d->atlas)
+                d->atlas->disconnect(this);
+            d->atlas = atlas;
+            d->atlasGeneration = atlas->generation();
+            connect(atlas, &CursorAtlas::generationChanged, this, &WQuickCursor::update);
+        }
+        if (d->atlasGeneration != atlas->generation()) {
+            // The atlas was reset, the sub rect of the node and the prewarmed images are gone
+            d->atlasGeneration = atlas->generation();
+            d->prewarmedTheme.clear();
+        }
+
+        const QByteArray theme = d->xcursorThemeName.toLatin1() + '/'
+                                 + QByteArray::number(d->getCursorSize())
+                                 + '@' + QByteArray::number(d->cursorImage->scale());
+        if (d->prewarmedTheme != theme) {
+            d->prewarmedTheme = theme;
+            atlas->prewarm(d->cursorImage->images(prewarmCursors()));
+        }
+
+        sourceRect = atlas->ensure(d->cursorImage->imageKey(), image);
+        if (!sourceRect.isNull())
+            texture = atlas->texture();
+    }
+
+    if (!texture) {
+        texture = tp->texture();
+        if (!texture) {
+            delete node;
+            return nullptr;
+        }
+        sourceRect = QRectF(QPointF(0, 0), texture->textureSize());
+    }
+
     auto imageNode = static_cast<QSGImageNode*>(node);
     if (!imageNode)
         imageNode = window()->createImageNode();
 
     imageNode->setTexture(texture);
     imageNode->setOwnsTexture(false);
-    imageNode->setSourceRect(QRectF(QPointF(0, 0), texture->textureSize()));
+    imageNode->setSourceRect(sourceRect);
     imageNode->setRect(QRectF(QPointF(0, 0), QSizeF(width(), height())));
     imageNode->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
     imageNode->setMipmapFiltering(QSGTexture::None);
@@ -608,3 +886,4 @@ void WQuickCursor::releaseResources()
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "moc_wquickcursor.cpp"
+#include "wquickcursor.moc"
@@ -19,6 +19,8 @@
 #include <qwrendererinterface.h>
 
 #include <QSGTexture>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
 #include <private/qquickrendercontrol_p.h>
 #include <private/qquickwindow_p.h>
 #include <private/qrhi_p.h>
@@ -37,6 +39,7 @@ extern "C" {
 }
 #include <drm_fourcc.h>
 #include <dlfcn.h>
+#include <unistd.h>
 
 QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
@@ -805,6 +808,88 @@ bool WRenderHelper::makeTexture(QRhi *rhi, qw_texture *handle, QSGPlainTexture *
     return true;
 }
 
+struct Q_DECL_HIDDEN EGLNativeFenceFunctions
+{
+    EGLNativeFenceFunctions() {
+        createSync = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+        destroySync = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+        waitSync = reinterpret_cast<PFNEGLWAITSYNCKHRPROC>(eglGetProcAddress("eglWaitSyncKHR"));
+        dupNativeFenceFD = reinterpret_cast<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>(eglGetProcAddress("eglDupNativeFenceFDANDROID"));
+    }
+
+    inline bool isValid() const {
+        return createSync && destroySync && waitSync && dupNativeFenceFD;
+    }
+
+    PFNEGLCREATESYNCKHRPROC createSync = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC destroySync = nullptr;
+    PFNEGLWAITSYNCKHRPROC waitSync = nullptr;
+    PFNEGLDUPNATIVEFENCEFDANDROIDPROC dupNativeFenceFD = nullptr;
+};
+
+static const EGLNativeFenceFunctions &eglNativeFenceFunctions()
+{
+    static EGLNativeFenceFunctions functions;
+    return functions;
+}
+
+int WRenderHelper::exportRenderFence(qw_renderer *renderer)
+{
+    if (!wlr_renderer_is_gles2(renderer->handle()))
+        return -1;
+
+    const auto &f = eglNativeFenceFunctions();
+    auto glContext = QOpenGLContext::currentContext();
+    if (!f.isValid() || !glContext)
+        return -1;
+
+    auto display = wlr_egl_get_display(wlr_gles2_renderer_get_egl(renderer->handle()));
+    EGLSyncKHR sync = f.createSync(display, EGL_SYNC_NATIVE_FENCE_ANDROID, nullptr);
+    if (sync == EGL_NO_SYNC_KHR)
+        return -1;
+
+    // The native fence fd is only available after the fence is flushed
+    glContext->functions()->glFlush();
+    int fd = f.dupNativeFenceFD(display, sync);
+    f.destroySync(display, sync);
+
+    return fd == EGL_NO_NATIVE_FENCE_FD_ANDROID ? -1 : fd;
+}
+
+bool WRenderHelper::canWaitSyncFile(qw_renderer *renderer)
+{
+    return wlr_renderer_is_gles2(renderer->handle()) && eglNativeFenceFunctions().isValid();
+}
+
+bool WRenderHelper::waitSyncFile(qw_renderer *renderer, int syncFileFd)
+{
+    Q_ASSERT(syncFileFd >= 0);
+
+    if (wlr_renderer_is_gles2(renderer->handle()) && QOpenGLContext::currentContext()) {
+        const auto &f = eglNativeFenceFunctions();
+        if (f.isValid()) {
+            auto display = wlr_egl_get_display(wlr_gles2_renderer_get_egl(renderer->handle()));
+            const EGLint attribs[] = {
+                EGL_SYNC_NATIVE_FENCE_FD_ANDROID, syncFileFd,
+                EGL_NONE,
+            };
+            EGLSyncKHR sync = f.createSync(display, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+            if (sync != EGL_NO_SYNC_KHR) {
+                // The fd is owned by the EGLSync now, the commands submitted
+                // after this will wait the fence in GPU.
+                const bool ok = f.waitSync(display, sync, 0) == EGL_TRUE;
+                f.destroySync(display, sync);
+                return ok;
+            }
+        }
+    }
+
+    // Don't block the compositor, the surfaces hold back their buffers until the
+    // acquire fences are signalled if the renderer can't wait them, see WSurfacePrivate.
+    close(syncFileFd);
+    return false;
+}
+
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "moc_wrenderhelper.cpp"
@@ -54,6 +54,14 @@ public:
 
     static bool makeTexture(QRhi *rhi, QW_NAMESPACE::qw_texture *handle, QSGPlainTexture *texture);
 
+    // Returns a sync_file fd signalled after the submitted commands of the current
+    // OpenGL context are finished, returns -1 if not supported.
+    static int exportRenderFence(QW_NAMESPACE::qw_renderer *renderer);
+    // Whether waitSyncFile can wait on the GPU for this renderer.
+    static bool canWaitSyncFile(QW_NAMESPACE::qw_renderer *renderer);
+    // Let the next commands wait the sync_file, the fd is owned by this function.
+    static bool waitSyncFile(QW_NAMESPACE::qw_renderer *renderer, int syncFileFd);
+
 Q_SIGNALS:
     void sizeChanged();
 
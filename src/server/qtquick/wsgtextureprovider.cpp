@@ -126,6 +126,14 @@ void WSGTextureProvider::setBuffer(qw_buffer *buffer)
 void WSGTextureProvider::setTexture(qw_texture *texture, qw_buffer *srcBuffer)
 {
     W_D(WSGTextureProvider);
+    // The texture of a wl_shm client buffer is updated in place by wlroots,
+    // keep the wrapped QRhiTexture instead of recreating it for every commit.
+    if (texture && texture == d->texture && !d->ownsTexture && d->rhiTexture) {
+        d->buffer = srcBuffer;
+        Q_EMIT textureChanged();
+        return;
+    }
+
     d->cleanTexture();
     d->texture = texture;
     d->buffer = srcBuffer;
@@ -10,6 +10,8 @@
 #include "woutputviewport.h"
 #include "wsgtextureprovider.h"
 #include "woutputrenderwindow.h"
+#include "wrenderhelper.h"
+#include "private/wsurface_p.h"
 
 #include <qwcompositor.h>
 #include <qwsubcompositor.h>
@@ -22,6 +24,7 @@
 #include <QSGImageNode>
 #include <QSGRenderNode>
 #include <private/qquickitem_p.h>
+#include <private/qeventpoint_p.h>
 
 QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
@@ -55,6 +58,8 @@ public:
         if (Q_UNLIKELY(!isValid()))
             return false;
 
+        if (d()->flattenSubsurfaces())
+            return d()->surfaceAt(point, nullptr);
         return d()->surface->inputRegionContains(point);
     }
 
@@ -102,15 +107,89 @@ private:
     }
 };
 
+// Locks the buffer of a surface, so the item can keep the last frame after the
+// surface is destroyed.
+class Q_DECL_HIDDEN SurfaceBuffer
+{
+public:
+    ~SurfaceBuffer() {
+        reset(nullptr, false);
+    }
+
+    inline qw_buffer *get() const {
+        return buffer.get();
+    }
+
+    void reset(qw_buffer *newBuffer, bool newLockIgnored) {
+        setLockIgnored(false);
+        if (newBuffer)
+            newBuffer->lock();
+        buffer.reset(newBuffer);
+        setLockIgnored(newLockIgnored);
+    }
+
+    // A live item always shows the latest commit of the surface, so its lock
+    // must not keep wlroots from updating the texture of a wl_shm client buffer
+    // in place with only the damaged region (wlr_client_buffer_apply_damage).
+    // A frozen item needs the real lock to keep its contents.
+    void setLockIgnored(bool ignored) {
+        if (lockIgnored == ignored)
+            return;
+
+        auto clientBuffer = buffer ? qw_client_buffer::get(*buffer) : nullptr;
+        if (!clientBuffer) {
+            lockIgnored = false;
+            return;
+        }
+
+        if (ignored) {
+            clientBuffer->handle()->n_ignore_locks++;
+        } else {
+            Q_ASSERT(clientBuffer->handle()->n_ignore_locks > 0);
+            clientBuffer->handle()->n_ignore_locks--;
+        }
+        lockIgnored = ignored;
+    }
+
+private:
+    std::unique_ptr<qw_buffer, qw_buffer::unlocker> buffer;
+    bool lockIgnored = false;
+};
+
 class Q_DECL_HIDDEN WSurfaceItemContentPrivate: public QQuickItemPrivate
 {
 public:
     WSurfaceItemContentPrivate(WSurfaceItemContent *qq){}
 
     ~WSurfaceItemContentPrivate() {
+        setBuffer(nullptr);
     }
 
+    void setBuffer(qw_buffer *newBuffer) {
+        buffer.reset(newBuffer, live);
+    }
+
+    // A subsurface of the tree rendered by this item, see WSurfaceItem::FlattenSubsurfaces
+    struct TreeSurface {
+        QPointer<WSurface> surface;
+        // Relative to the root surface
+        QPointF position;
+        QSizeF size;
+        QRectF bufferSourceBox;
+        SurfaceBuffer buffer;
+        // Only used in the rendering thread
+        WSGTextureProvider *textureProvider = nullptr;
+    };
+
+    void setFlattenSubsurfaces(bool on);
+    void scheduleSurfaceTreeUpdate();
+    void updateSurfaceTree();
+    void clearSurfaceTree();
+    QSGNode *updateSurfaceTreeNode(QSGNode *oldNode, WSGTextureProvider *rootProvider);
+    void updateTexture(WSGTextureProvider *tp, WSurface *surface, qw_buffer *buffer);
+
     void cleanTextureProvider();
+    void releaseTextureProvider(WSGTextureProvider *&tp);
 
     void invalidate() {
         W_Q(WSurfaceItemContent);
@@ -127,8 +206,15 @@ public:
 
         Q_ASSERT(!updateTextureConnection);
 
+        // Keep the subsurfaces of the last frame, but stop tracking them
+        for (const auto &entry : surfaceTree) {
+            if (entry->surface)
+                entry->surface->safeDisconnect(q);
+        }
+
         if (dontCacheLastBuffer) {
-            buffer.reset();
+            setBuffer(nullptr);
+            clearSurfaceTree();
             cleanTextureProvider();
             q->update();
         }
@@ -142,19 +228,21 @@ public:
         });
         surface->safeConnect(&qw_surface::notify_commit, q, [this] {
             updateSurfaceState();
+            if (flattenSubsurfaces)
+                scheduleSurfaceTreeUpdate();
         });
 
         Q_ASSERT(!updateTextureConnection);
         updateTextureConnection = surface->safeConnect(&WSurface::bufferChanged, q, [q, this] {
-            buffer.reset(surface->buffer());
             // lock buffer to ensure the WSurfaceItem can keep the last frame after WSurface destroyed.
-            if (buffer)
-                buffer->lock();
+            setBuffer(surface->buffer());
             q->update();
         });
 
         updateFrameDoneConnection();
         updateSurfaceState();
+        if (flattenSubsurfaces)
+            scheduleSurfaceTreeUpdate();
 
         q->rendered = true;
     }
@@ -169,20 +257,33 @@ public:
 
         // wayland protocol job should not run in rendering thread, so set context qobject to contentItem
         frameDoneConnection = QObject::connect(q->window(), &QQuickWindow::afterRendering, q, [this, q](){
-            if ((q->rendered || q->isVisible()) && live) {
+            if ((q->rendered || q->isVisible()) && live && !onlyOnPoweredOffOutputs()) {
                 surface->notifyFrameDone();
+                for (const auto &entry : surfaceTree) {
+                    if (entry->surface)
+                        entry->surface->notifyFrameDone();
+                }
                 q->rendered = false;
             }
         }); // if signal is emitted from seperated rendering thread, default QueuedConnection is used
     }
 
+    // Don't drive the frames of the client that's only shown on the
+    // powered off outputs, it gets the next frame after the resume.
+    bool onlyOnPoweredOffOutputs() const {
+        if (!surface)
+            return false;
+        const auto outputs = surface->outputs();
+        return !outputs.isEmpty() && std::none_of(outputs.cbegin(), outputs.cend(), [] (WOutput *output) {
+            return output->isPowerOn();
+        });
+    }
+
     void updateSurfaceState() {
         if (!surface)
             return;
 
-        qw_fbox tmp;
-        surface->handle()->get_buffer_source_box(tmp);
-        bufferSourceBox = tmp.toQRectF();
+        bufferSourceBox = surface->bufferSourceBox();
 
         W_Q(WSurfaceItemContent);
 
@@ -203,11 +304,18 @@ public:
 
     QMetaObject::Connection frameDoneConnection;
     mutable WSGTextureProvider *textureProvider = nullptr;
-    std::unique_ptr<qw_buffer, qw_buffer::unlocker> buffer;
+    SurfaceBuffer buffer;
     mutable QMetaObject::Connection updateTextureConnection;
     bool dontCacheLastBuffer = false;
     bool live = true;
     bool ignoreBufferOffset = false;
+
+    // The subsurfaces in their stacking order, the root surface is drawn
+    // before the entry at surfaceTreeRootIndex.
+    std::vector<std::unique_ptr<TreeSurface>> surfaceTree;
+    int surfaceTreeRootIndex = 0;
+    bool flattenSubsurfaces = false;
+    bool surfaceTreeIsDirty = false;
 };
 
 
@@ -338,6 +446,9 @@ void WSurfaceItemContent::setLive(bool live)
     if (d->live == live)
         return;
     d->live = live;
+    d->buffer.setLockIgnored(live);
+    for (const auto &entry : d->surfaceTree)
+        entry->buffer.setLockIgnored(live);
     if (live)
         update();
     Q_EMIT liveChanged();
@@ -394,25 +505,39 @@ public:
     QPointer<WSurfaceItemContent> m_owner;
 };
 
+// Renders a flattened surface tree, the children after the footprint node are
+// the image nodes of the surfaces in their stacking order.
+class Q_DECL_HIDDEN WSGSurfaceTreeNode : public QSGNode
+{
+public:
+    WSGSurfaceTreeNode(WSurfaceItemContent *owner) {
+        appendChildNode(new WSGRenderFootprintNode(owner));
+    }
+
+    QList<QSGImageNode*> imageNodes;
+};
+
 QSGNode *WSurfaceItemContent::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
     W_D(WSurfaceItemContent);
 
     auto tp = wTextureProvider();
-    if (d->live || !tp->texture()) {
-        auto texture = d->surface ? d->surface->handle()->get_texture() : nullptr;
-        if (texture) {
-            tp->setTexture(qw_texture::from(texture), d->buffer.get());
-        } else {
-            tp->setBuffer(d->buffer.get());
-        }
-    }
+    if (d->live || !tp->texture())
+        d->updateTexture(tp, d->surface, d->buffer.get());
 
     if (!tp->texture() || width() <= 0 || height() <= 0) {
         delete oldNode;
         return nullptr;
     }
 
+    if (d->flattenSubsurfaces && !d->surfaceTree.empty())
+        return d->updateSurfaceTreeNode(oldNode, tp);
+
+    if (oldNode && oldNode->type() != QSGNode::GeometryNodeType) {
+        delete oldNode;
+        oldNode = nullptr;
+    }
+
     auto node = static_cast<QSGImageNode*>(oldNode);
     if (Q_UNLIKELY(!node)) {
         node = window()->createImageNode();
@@ -423,6 +548,8 @@ QSGNode *WSurfaceItemContent::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeD
 
     auto texture = tp->texture();
     node->setTexture(texture);
+    // The crop and scale of wp_viewporter are applied by the sampler, the
+    // client can attach a buffer of any size without scaling it itself.
     const QRectF textureGeometry = d->bufferSourceBox;
     node->setSourceRect(textureGeometry);
     const QRectF targetGeometry(d->ignoreBufferOffset ? QPointF() : d->bufferOffset, size());
@@ -432,6 +559,15 @@ QSGNode *WSurfaceItemContent::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeD
     return node;
 }
 
+void WSurfaceItemContent::updatePolish()
+{
+    QQuickItem::updatePolish();
+
+    W_D(WSurfaceItemContent);
+    if (d->surfaceTreeIsDirty)
+        d->updateSurfaceTree();
+}
+
 void WSurfaceItemContent::releaseResources()
 {
     W_D(WSurfaceItemContent);
@@ -458,6 +594,11 @@ void WSurfaceItemContent::invalidateSceneGraph()
     if (d->textureProvider)
         delete d->textureProvider;
     d->textureProvider = nullptr;
+
+    for (const auto &entry : d->surfaceTree) {
+        delete entry->textureProvider;
+        entry->textureProvider = nullptr;
+    }
 }
 
 WSurfaceItem::WSurfaceItem(QQuickItem *parent)
@@ -585,12 +726,17 @@ void WSurfaceItem::setFlags(const Flags &newFlags)
 
     if (d->surfaceFlags == newFlags)
         return;
+    const bool flattenChanged = d->surfaceFlags.testFlag(FlattenSubsurfaces)
+                                != newFlags.testFlag(FlattenSubsurfaces);
     d->surfaceFlags = newFlags;
     d->updateEventItem(false);
 
     if (auto content = d->getItemContent())
         content->setCacheLastBuffer(!newFlags.testFlag(DontCacheLastBuffer));
 
+    if (flattenChanged)
+        d->updateFlattenSubsurfaces();
+
     for (auto sub : std::as_const(d->subsurfaces))
         sub->setFlags(newFlags);
 
@@ -660,6 +806,10 @@ void WSurfaceItem::setDelegate(QQmlComponent *newDelegate)
     for (auto sub : std::as_const(d->subsurfaces))
         sub->setDelegate(newDelegate);
 
+    // The delegate can't render the flattened subsurfaces
+    if (d->surfaceFlags.testFlag(FlattenSubsurfaces))
+        d->updateFlattenSubsurfaces();
+
     Q_EMIT delegateChanged();
 }
 
@@ -829,6 +979,21 @@ bool WSurfaceItem::sendEvent(QInputEvent *event)
     if (!d->surface)
         return false;
 
+    if (d->flattenSubsurfaces()) {
+        switch (event->type()) {
+        case QEvent::HoverEnter: Q_FALLTHROUGH();
+        case QEvent::HoverLeave: Q_FALLTHROUGH();
+        case QEvent::HoverMove: Q_FALLTHROUGH();
+        case QEvent::MouseMove: Q_FALLTHROUGH();
+        case QEvent::MouseButtonPress: Q_FALLTHROUGH();
+        case QEvent::MouseButtonRelease: Q_FALLTHROUGH();
+        case QEvent::Wheel:
+            return d->sendSurfaceTreeEvent(static_cast<QSinglePointEvent*>(event));
+        default:
+            break;
+        }
+    }
+
     return WSeat::sendEvent(d->surface.get(), this, d->eventItem, event);
 }
 
@@ -995,6 +1160,7 @@ void WSurfaceItemPrivate::initForDelegate()
         if (surface)
             contentItem->setSurface(surface);
         contentItem->setCacheLastBuffer(!surfaceFlags.testFlag(WSurfaceItem::DontCacheLastBuffer));
+        contentItem->d_func()->setFlattenSubsurfaces(flattenSubsurfaces());
         contentItem->setSmooth(q->smooth());
         QObject::connect(q, &WSurfaceItem::smoothChanged, contentItem, &WSurfaceItemContent::setSmooth);
         newContentContainer.reset(contentItem);
@@ -1049,6 +1215,10 @@ void WSurfaceItemPrivate::onHasSubsurfaceChanged()
 
 void WSurfaceItemPrivate::updateSubsurfaceItem()
 {
+    // The content item renders the subsurfaces
+    if (flattenSubsurfaces())
+        return;
+
     Q_Q(WSurfaceItem);
     auto surface = this->surface->handle()->handle();
     Q_ASSERT(surface);
@@ -1147,6 +1317,122 @@ WSurfaceItem *WSurfaceItemPrivate::ensureSubsurfaceItem(WSurface *subsurfaceSurf
     return surfaceItem;
 }
 
+void WSurfaceItemPrivate::updateFlattenSubsurfaces()
+{
+    const bool flatten = flattenSubsurfaces();
+    if (auto content = getItemContent())
+        content->d_func()->setFlattenSubsurfaces(flatten);
+
+    if (flatten) {
+        for (auto item : std::as_const(subsurfaces)) {
+            item->setVisible(false);
+            item->deleteLater();
+        }
+        subsurfaces.clear();
+    } else {
+        pointerTarget = nullptr;
+        qDeleteAll(std::exchange(subsurfaceEventObjects, {}));
+
+        if (componentComplete && surface && contentContainer)
+            updateSubsurfaceItem();
+    }
+}
+
+WSurface *WSurfaceItemPrivate::surfaceAt(const QPointF &position, QPointF *localPosition) const
+{
+    double sx, sy;
+    auto s = wlr_surface_surface_at(surface->handle()->handle(), position.x(), position.y(), &sx, &sy);
+    auto target = s ? WSurface::fromHandle(s) : nullptr;
+    if (target && localPosition)
+        *localPosition = QPointF(sx, sy);
+
+    return target;
+}
+
+QObject *WSurfaceItemPrivate::eventObjectOf(WSurface *target)
+{
+    if (target == surface)
+        return eventItem;
+
+    // Stands for the subsurface in the pointer focus of WSeat
+    auto &object = subsurfaceEventObjects[target];
+    if (!object) {
+        object = new QObject(q_func());
+        target->safeConnect(&WSurface::aboutToBeInvalidated, object, [this, target] {
+            if (auto object = subsurfaceEventObjects.take(target))
+                object->deleteLater();
+        });
+    }
+
+    return object;
+}
+
+static inline void setEventPointPosition(QEventPoint &point, const QPointF &position)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    QMutableEventPoint::setPosition(point, position);
+#else
+    QMutableEventPoint::from(point).setPosition(position);
+#endif
+}
+
+bool WSurfaceItemPrivate::sendSurfaceTreeEvent(QSinglePointEvent *event)
+{
+    Q_Q(WSurfaceItem);
+
+    if (event->type() == QEvent::HoverLeave) {
+        WSurface *target = pointerTarget ? pointerTarget.get() : surface.get();
+        pointerTarget = nullptr;
+        return WSeat::sendEvent(target, q, eventObjectOf(target), event);
+    }
+
+    WSurface *target = nullptr;
+    QPointF offset;
+    // Like the implicit grab of wl_pointer, keep the target while a button is pressed
+    if (pointerTarget && (event->buttons() != Qt::NoButton
+                          || event->type() == QEvent::MouseButtonRelease)) {
+        target = pointerTarget;
+        offset = pointerTargetOffset;
+    } else {
+        QPointF localPosition;
+        target = surfaceAt(event->position(), &localPosition);
+        if (target)
+            offset = event->position() - localPosition;
+        else
+            target = surface;
+    }
+
+    if (event->type() != QEvent::HoverEnter && target != pointerTarget) {
+        // Moved to another surface of the tree
+        if (pointerTarget) {
+            QHoverEvent leave(QEvent::HoverLeave, QPointF(), event->globalPosition(), QPointF(),
+                              event->modifiers(), event->pointingDevice());
+            leave.setTimestamp(event->timestamp());
+            WSeat::sendEvent(pointerTarget, q, eventObjectOf(pointerTarget), &leave);
+        }
+
+        const QPointF localPosition = event->position() - offset;
+        QHoverEvent enter(QEvent::HoverEnter, localPosition, event->globalPosition(), localPosition,
+                          event->modifiers(), event->pointingDevice());
+        enter.setTimestamp(event->timestamp());
+        WSeat::sendEvent(target, q, eventObjectOf(target), &enter);
+    }
+
+    pointerTarget = target;
+    pointerTargetOffset = offset;
+
+    if (offset.isNull())
+        return WSeat::sendEvent(target, q, eventObjectOf(target), event);
+
+    // Deliver in the local coordinates of the target
+    const QPointF position = event->position();
+    setEventPointPosition(event->point(0), position - offset);
+    const bool ok = WSeat::sendEvent(target, q, eventObjectOf(target), event);
+    setEventPointPosition(event->point(0), position);
+
+    return ok;
+}
+
 void WSurfaceItemPrivate::resizeSurfaceToItemSize(const QSize &itemSize, const QSize &sizeDiff)
 {
     Q_Q(WSurfaceItem);
@@ -1259,7 +1545,14 @@ bool WSurfaceItem::setShellSurface(WToplevelSurface *surface)
 
 void WSurfaceItemContentPrivate::cleanTextureProvider()
 {
-    if (textureProvider) {
+    releaseTextureProvider(textureProvider);
+    for (const auto &entry : surfaceTree)
+        releaseTextureProvider(entry->textureProvider);
+}
+
+void WSurfaceItemContentPrivate::releaseTextureProvider(WSGTextureProvider *&tp)
+{
+    if (tp) {
         // needs check window, because maybe this item's window always is nullptr,
         // so not call WSurfaceItemContent::releaseResources before destroy.
         if (window) {
@@ -1274,16 +1567,209 @@ void WSurfaceItemContentPrivate::cleanTextureProvider()
             };
 
                    // Delay clean the textures on the next render after.
-            window->scheduleRenderJob(new WSurfaceItemContentCleanupJob(textureProvider),
+            window->scheduleRenderJob(new WSurfaceItemContentCleanupJob(tp),
                                       QQuickWindow::AfterRenderingStage);
         } else {
-            delete textureProvider;
+            delete tp;
         }
 
-        textureProvider = nullptr;
+        tp = nullptr;
     }
 }
 
+void WSurfaceItemContentPrivate::updateTexture(WSGTextureProvider *tp, WSurface *surface, qw_buffer *buffer)
+{
+    wlr_texture *texture = nullptr;
+    if (surface && WSurfacePrivate::get(surface)->acquireFenceIsPending()) {
+        // The client is still rendering the current buffer of the surface,
+        // keep sampling the held back buffer.
+        if (auto clientBuffer = buffer ? qw_client_buffer::get(*buffer) : nullptr)
+            texture = clientBuffer->handle()->texture;
+    } else if (surface) {
+        texture = surface->handle()->get_texture();
+    }
+
+    if (texture) {
+        // Explicit sync, let QtQuick wait the client's rendering before sampling
+        const int acquireFence = WSurfacePrivate::get(surface)->takeAcquireFence();
+        if (acquireFence >= 0) {
+            auto renderWindow = qobject_cast<WOutputRenderWindow*>(window);
+            Q_ASSERT(renderWindow);
+            if (!WRenderHelper::waitSyncFile(renderWindow->renderer(), acquireFence))
+                qWarning() << "Failed to wait the acquire fence of" << surface;
+        }
+        tp->setTexture(qw_texture::from(texture), buffer);
+    } else {
+        tp->setBuffer(buffer);
+    }
+}
+
+void WSurfaceItemContentPrivate::setFlattenSubsurfaces(bool on)
+{
+    if (flattenSubsurfaces == on)
+        return;
+
+    flattenSubsurfaces = on;
+    if (on) {
+        scheduleSurfaceTreeUpdate();
+    } else {
+        clearSurfaceTree();
+    }
+}
+
+void WSurfaceItemContentPrivate::scheduleSurfaceTreeUpdate()
+{
+    if (surfaceTreeIsDirty)
+        return;
+
+    // The commits of synchronized subsurfaces are applied together with their
+    // parent's commit, so they are collected into one walk of the tree per frame.
+    surfaceTreeIsDirty = true;
+    q_func()->polish();
+}
+
+void WSurfaceItemContentPrivate::updateSurfaceTree()
+{
+    W_Q(WSurfaceItemContent);
+
+    surfaceTreeIsDirty = false;
+    // Keep the last frame of the tree after the surface is invalidated
+    if (!surface || !flattenSubsurfaces)
+        return;
+
+    struct TreeWalker {
+        wlr_surface *root;
+        QList<std::pair<WSurface*, QPointF>> surfaces;
+        int rootIndex = 0;
+    } walker { surface->handle()->handle() };
+
+    wlr_surface_for_each_surface(walker.root, [] (wlr_surface *s, int sx, int sy, void *data) {
+        auto walker = static_cast<TreeWalker*>(data);
+        if (s == walker->root) {
+            walker->rootIndex = walker->surfaces.size();
+        } else if (auto surface = WSurface::fromHandle(s)) {
+            walker->surfaces.append({surface, QPointF(sx, sy)});
+        }
+    }, &walker);
+
+    auto oldTree = std::exchange(surfaceTree, {});
+    surfaceTree.reserve(walker.surfaces.size());
+
+    for (const auto &[subsurface, position] : std::as_const(walker.surfaces)) {
+        auto it = std::find_if(oldTree.begin(), oldTree.end(), [subsurface] (const auto &entry) {
+            return entry->surface == subsurface;
+        });
+
+        std::unique_ptr<TreeSurface> entry;
+        if (it != oldTree.end()) {
+            entry = std::move(*it);
+            oldTree.erase(it);
+        } else {
+            entry.reset(new TreeSurface);
+            entry->surface = subsurface;
+            subsurface->safeConnect(&qw_surface::notify_commit, q, [this] {
+                scheduleSurfaceTreeUpdate();
+            });
+            subsurface->safeConnect(&WSurface::aboutToBeInvalidated, q, [this] {
+                scheduleSurfaceTreeUpdate();
+            });
+        }
+
+        entry->position = position;
+        entry->size = subsurface->size();
+        entry->bufferSourceBox = subsurface->bufferSourceBox();
+        if (entry->buffer.get() != subsurface->buffer())
+            entry->buffer.reset(subsurface->buffer(), live);
+
+        surfaceTree.push_back(std::move(entry));
+    }
+    surfaceTreeRootIndex = walker.rootIndex;
+
+    for (const auto &entry : oldTree) {
+        if (entry->surface)
+            entry->surface->safeDisconnect(q);
+        releaseTextureProvider(entry->textureProvider);
+    }
+
+    q->update();
+}
+
+void WSurfaceItemContentPrivate::clearSurfaceTree()
+{
+    W_Q(WSurfaceItemContent);
+
+    for (const auto &entry : surfaceTree) {
+        if (entry->surface)
+            entry->surface->safeDisconnect(q);
+        releaseTextureProvider(entry->textureProvider);
+    }
+    surfaceTree.clear();
+    surfaceTreeRootIndex = 0;
+    q->update();
+}
+
+QSGNode *WSurfaceItemContentPrivate::updateSurfaceTreeNode(QSGNode *oldNode, WSGTextureProvider *rootProvider)
+{
+    W_Q(WSurfaceItemContent);
+
+    if (oldNode && oldNode->type() == QSGNode::GeometryNodeType) {
+        delete oldNode;
+        oldNode = nullptr;
+    }
+
+    auto node = static_cast<WSGSurfaceTreeNode*>(oldNode);
+    if (Q_UNLIKELY(!node))
+        node = new WSGSurfaceTreeNode(q);
+
+    const auto filtering = q->smooth() ? QSGTexture::Linear : QSGTexture::Nearest;
+    qsizetype nodeCount = 0;
+    auto addImageNode = [&] (QSGTexture *texture, const QRectF &sourceRect, const QRectF &rect) {
+        QSGImageNode *imageNode;
+        if (nodeCount < node->imageNodes.size()) {
+            imageNode = node->imageNodes.at(nodeCount);
+        } else {
+            imageNode = window->createImageNode();
+            imageNode->setOwnsTexture(false);
+            node->appendChildNode(imageNode);
+            node->imageNodes.append(imageNode);
+        }
+        ++nodeCount;
+
+        imageNode->setTexture(texture);
+        imageNode->setSourceRect(sourceRect);
+        imageNode->setRect(rect);
+        imageNode->setFiltering(filtering);
+    };
+
+    for (int i = 0; i <= int(surfaceTree.size()); ++i) {
+        if (i == surfaceTreeRootIndex) {
+            addImageNode(rootProvider->texture(), bufferSourceBox,
+                         QRectF(ignoreBufferOffset ? QPointF() : bufferOffset, q->size()));
+        }
+
+        if (i == int(surfaceTree.size()))
+            break;
+
+        const auto &entry = surfaceTree.at(i);
+        if (!entry->textureProvider)
+            entry->textureProvider = new WSGTextureProvider(qobject_cast<WOutputRenderWindow*>(window));
+        auto tp = entry->textureProvider;
+        if (live || !tp->texture())
+            updateTexture(tp, entry->surface, entry->buffer.get());
+
+        if (!tp->texture() || entry->size.isEmpty())
+            continue;
+
+        addImageNode(tp->texture(), entry->bufferSourceBox, QRectF(entry->position, entry->size));
+    }
+
+    // Remove the nodes of the surfaces that left the tree
+    while (node->imageNodes.size() > nodeCount)
+        delete node->imageNodes.takeLast();
+
+    return node;
+}
+
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "wsurfaceitem.moc"
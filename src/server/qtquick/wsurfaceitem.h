@@ -71,6 +71,7 @@ private:
 
     void componentComplete() override;
     QSGNode *updatePaintNode(QSGNode *, UpdatePaintNodeData *) override;
+    void updatePolish() override;
     void releaseResources() override;
     void itemChange(ItemChange change, const ItemChangeData &data) override;
     QAtomicInteger<bool> rendered = false;
@@ -117,7 +118,10 @@ public:
 
     enum Flag {
         DontCacheLastBuffer = 0x1,
-        RejectEvent = 0x2
+        RejectEvent = 0x2,
+        // Render the subsurfaces in the content item instead of creating a
+        // WSurfaceItem for each of them, ignored if the delegate is set.
+        FlattenSubsurfaces = 0x4
     };
     Q_ENUM(Flag)
     Q_DECLARE_FLAGS(Flags, Flag)
@@ -471,6 +471,23 @@ static inline const char *qcursorShapeToType(std::underlying_type_t<WGlobal::Cur
     return nullptr;
 }
 
+static QByteArray xcursorImageKey(const qw_xcursor_manager *manager, const wlr_xcursor *xcursor,
+                                  float scale, int index)
+{
+    return QByteArray(manager->handle()->name ? manager->handle()->name : "")
+           + '/' + QByteArray::number(manager->handle()->size)
+           + '/' + xcursor->name
+           + '@' + QByteArray::number(scale)
+           + '#' + QByteArray::number(index);
+}
+
+static inline QImage xcursorImage(const wlr_xcursor_image *ximage)
+{
+    return QImage(static_cast<const uchar*>(ximage->buffer),
+                  ximage->width, ximage->height,
+                  QImage::Format_ARGB32_Premultiplied);
+}
+
 class Q_DECL_HIDDEN WCursorImagePrivate : public QObjectPrivate {
 public:
     WCursorImagePrivate() {
@@ -482,7 +499,7 @@ public:
         Q_ASSERT(ok);
     }
 
-    void setImage(const QImage &image, const QPoint &hotspot);
+    void setImage(const QImage &image, const QPoint &hotspot, const QByteArray &key = {});
     void updateCursorImage();
     void playXCursor();
 
@@ -490,6 +507,7 @@ public:
 
     QImage image;// TODO: supports multi threads
     QPoint hotSpot;
+    QByteArray imageKey;
 
     QCursor cursor;
     std::shared_ptr<qw_xcursor_manager> manager;
@@ -503,10 +521,16 @@ public:
 };
 thread_local QList<WCursorImagePrivate*> WCursorImagePrivate::cursorImages;
 
-void WCursorImagePrivate::setImage(const QImage &image, const QPoint &hotspot) {
+void WCursorImagePrivate::setImage(const QImage &image, const QPoint &hotspot, const QByteArray &key) {
     this->image = image;
     this->image.setDevicePixelRatio(scale);
     this->hotSpot = hotspot;
+    if (!key.isEmpty())
+        this->imageKey = key;
+    else if (!image.isNull())
+        this->imageKey = "image/" + QByteArray::number(image.cacheKey());
+    else
+        this->imageKey.clear();
     Q_EMIT q_func()->imageChanged();
 }
 
@@ -521,7 +545,8 @@ void WCursorImagePrivate::updateCursorImage()
         tempTimer->stop();
 
     if (cursor.shape() == Qt::BitmapCursor) {
-        setImage(cursor.pixmap().toImage(), cursor.hotSpot());
+        setImage(cursor.pixmap().toImage(), cursor.hotSpot(),
+                 "bitmap/" + QByteArray::number(cursor.pixmap().cacheKey()));
         return;
     }
 
@@ -546,10 +571,8 @@ void WCursorImagePrivate::updateCursorImage()
 
     if (xcursor->image_count == 1) {
         auto ximage = xcursor->images[0];
-        setImage(QImage(static_cast<const uchar*>(ximage->buffer),
-                        ximage->width, ximage->height,
-                        QImage::Format_ARGB32_Premultiplied),
-                 QPoint(ximage->hotspot_x, ximage->hotspot_y));
+        setImage(xcursorImage(ximage), QPoint(ximage->hotspot_x, ximage->hotspot_y),
+                 xcursorImageKey(manager.get(), xcursor, scale, 0));
         return;
     }
 
@@ -573,10 +596,8 @@ void WCursorImagePrivate::playXCursor()
     Q_ASSERT(!xcursorPlayTimer->isActive());
 
     auto ximage = xcursor->images[currentXCursorImageIndex];
-    setImage(QImage(static_cast<const uchar*>(ximage->buffer),
-                    ximage->width, ximage->height,
-                    QImage::Format_ARGB32_Premultiplied),
-             QPoint(ximage->hotspot_x, ximage->hotspot_y));
+    setImage(xcursorImage(ximage), QPoint(ximage->hotspot_x, ximage->hotspot_y),
+             xcursorImageKey(manager.get(), xcursor, scale, currentXCursorImageIndex));
 
     currentXCursorImageIndex = (currentXCursorImageIndex + 1) % xcursor->image_count;
     xcursorPlayTimer->start(ximage->delay);
@@ -600,6 +621,37 @@ QPoint WCursorImage::hotSpot() const
     return d->hotSpot;
 }
 
+QByteArray WCursorImage::imageKey() const
+{
+    Q_D(const WCursorImage);
+    return d->imageKey;
+}
+
+QList<std::pair<QByteArray, QImage>> WCursorImage::images(const QList<QCursor> &cursors) const
+{
+    Q_D(const WCursorImage);
+
+    QList<std::pair<QByteArray, QImage>> list;
+    if (!d->manager)
+        return list;
+
+    for (const auto &cursor : cursors) {
+        auto cursorName = qcursorShapeToType(cursor.shape());
+        if (!cursorName)
+            continue;
+        auto xcursor = getXCursorWithFallback(d->manager.get(), cursorName, d->scale);
+        if (!xcursor)
+            continue;
+
+        for (uint i = 0; i < xcursor->image_count; ++i) {
+            list.append({xcursorImageKey(d->manager.get(), xcursor, d->scale, i),
+                         xcursorImage(xcursor->images[i])});
+        }
+    }
+
+    return list;
+}
+
 QCursor WCursorImage::cursor() const
 {
     Q_D(const WCursorImage);
@@ -22,6 +22,11 @@ public:
 
     QImage image() const;
     QPoint hotSpot() const;
+    // Unique for the theme, shape, scale and animation frame of the current image,
+    // it's used as the key of the cursor texture caches.
+    QByteArray imageKey() const;
+    // Returns all frames of the cursors with the current theme and scale
+    QList<std::pair<QByteArray, QImage>> images(const QList<QCursor> &cursors) const;
 
     QCursor cursor() const;
     void setCursor(const QCursor &newCursor);
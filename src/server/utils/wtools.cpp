@@ -14,6 +14,7 @@ extern "C" {
 
 #include <pixman.h>
 #include <drm_fourcc.h>
+#include <time.h>
 
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -145,6 +146,45 @@ QImage::Format WTools::toImageFormat(uint32_t drmFormat)
     return QImage::Format_Invalid;
 }
 
+// Average bytes of a pixel, including the chroma planes of the YUV formats
+qreal WTools::drmFormatBytesPerPixel(uint32_t drmFormat)
+{
+    switch (drmFormat) {
+    case DRM_FORMAT_NV12:
+    case DRM_FORMAT_NV21:
+    case DRM_FORMAT_YUV420:
+    case DRM_FORMAT_YVU420:
+        return 1.5;
+    case DRM_FORMAT_P010:
+    case DRM_FORMAT_P012:
+    case DRM_FORMAT_P016:
+        return 3;
+    case DRM_FORMAT_RGB565:
+    case DRM_FORMAT_BGR565:
+    case DRM_FORMAT_NV16:
+    case DRM_FORMAT_NV61:
+    case DRM_FORMAT_YUYV:
+    case DRM_FORMAT_UYVY:
+        return 2;
+    case DRM_FORMAT_RGB888:
+    case DRM_FORMAT_BGR888:
+        return 3;
+    case DRM_FORMAT_ARGB16161616F:
+    case DRM_FORMAT_XRGB16161616F:
+    case DRM_FORMAT_ABGR16161616F:
+    case DRM_FORMAT_XBGR16161616F:
+    case DRM_FORMAT_ARGB16161616:
+    case DRM_FORMAT_XRGB16161616:
+    case DRM_FORMAT_ABGR16161616:
+    case DRM_FORMAT_XBGR16161616:
+        return 8;
+    default: break;
+    }
+
+    // The 8-bit and 10-bit RGB formats and the unknown formats
+    return 4;
+}
+
 uint32_t WTools::toDrmFormat(QImage::Format format)
 {
     switch (format) {
@@ -308,4 +348,11 @@ Qt::Edges WTools::toQtEdge(uint32_t edges)
     return qedges;
 }
 
+qint64 WTools::monotonicNsecs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
 WAYLIB_SERVER_END_NAMESPACE
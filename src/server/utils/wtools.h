@@ -19,6 +19,7 @@ public:
     static QImage fromPixmanImage(void *image, void *data = nullptr);
     static QImage::Format toImageFormat(uint32_t drmFormat);
     static uint32_t toDrmFormat(QImage::Format format);
+    static qreal drmFormatBytesPerPixel(uint32_t drmFormat);
     static QImage::Format convertToDrmSupportedFormat(QImage::Format format);
     static uint32_t shmToDrmFormat(wl_shm_format shmFmt);
     static wl_shm_format drmToShmFormat(uint32_t drmFmt);
@@ -27,6 +28,8 @@ public:
     static QRect fromWLRBox(void *box);
     static void toWLRBox(const QRect &rect, void *box);
     static Qt::Edges toQtEdge(uint32_t edges);
+    // CLOCK_MONOTONIC in nanoseconds, the clock of the wlroots presentation events
+    static qint64 monotonicNsecs();
 };
 
 WAYLIB_SERVER_END_NAMESPACE